@@ -0,0 +1,325 @@
+// Large-library benchmark for the host build (make bench). Fabricates N dumps spread over
+// the internal roots and a few fake USB drives, then runs the real daemon code against them
+// and prints one JSON object per scenario and phase on stdout:
+//   startup_count   count_new_candidates() on an empty index (cold start)
+//   cold_scan       first scan_all_paths() + install_drain(), as main() does at startup
+//   settle_install  a tenth more dumps copied in fresh, then the daemon loop until every dump
+//                   is mounted and registered (the fresh ones only after SETTLE_SECS)
+//   steady_idle     scan cycles with nothing changed
+//   steady_relist   scan cycles with every root relisted (warm cache)
+//   warm_start      fresh process: index_load() + count_new_candidates()
+// Each phase reports wall time, read/write syscalls and bytes (/proc/self/io), stat() calls
+// on the scan path, context switches, RSS and peak RSS.
+//
+// Every path the daemon touches (/data/homebrew, /data/etaHEN/games, /data/shadowmount,
+// /user/app, /user/appmeta, /system_ex/app) gets a fresh tmpfs per scenario, as does each
+// fake drive (/mnt/smbenchN), so it needs root in a container or VM and leaves nothing
+// behind. --device uses an existing mount under /mnt (e.g. an ext4 loop device) instead of
+// the tmpfs drives; only the bench_* dumps created there are removed again.
+//
+//   shadowmount-bench [-n 10,100,1000,5000] [-d drives] [-c cycles] [-f files] [-a asset_kb] [--device /mnt/x]...
+// The fake AppInstUtil and mounts take their usual SM_FAKE_* settings (src/platform_linux.c).
+#define main shadowmount_main
+#include "main.c"
+#undef main
+#include "fixture.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define BENCH_MAX_DEVICES   8
+#define BENCH_MAX_SCENARIOS 16
+#define BENCH_PREFIX        "bench_"
+
+// Locales of a typical retail param.json
+const char* BENCH_LOCALES[] = {
+    "ar-AE", "cs-CZ", "da-DK", "de-DE", "el-GR", "en-GB", "en-US", "es-419", "es-ES", "fi-FI", "fr-CA", "fr-FR",
+    "hu-HU", "id-ID", "it-IT", "ja-JP", "ko-KR", "nl-NL", "no-NO", "pl-PL", "pt-BR", "pt-PT", "ro-RO", "ru-RU",
+    "sv-SE", "th-TH", "tr-TR", "uk-UA", "vi-VN", "zh-Hans", "zh-Hant", NULL
+};
+
+// sce_sys asset set, sizes in KB at --asset-kb 256 (the default); copied to /user/app on install
+struct BenchAsset { const char* name; unsigned kb; };
+const struct BenchAsset BENCH_ASSETS[] = {
+    { "icon0.png", 96 }, { "pic0.png", 112 }, { "keystone", 1 }, { "nptitle.dat", 1 }, { "npbind.dat", 1 },
+    { "trophy2/trophy00.ucp", 32 }, { "about/right.sprx", 12 }, { "changeinfo/changeinfo.xml", 1 }, { NULL, 0 }
+};
+
+struct BenchOpts {
+    int counts[BENCH_MAX_SCENARIOS], n_counts;
+    int drives;                         // tmpfs drives when no --device is given
+    const char* devices[BENCH_MAX_DEVICES]; int n_devices;
+    int cycles;                         // steady_idle cycles; steady_relist runs a fifth of them
+    int files;                          // Content files per dump (sparse)
+    unsigned asset_kb;
+};
+struct BenchOpts opts = { { 10, 100, 1000, 5000 }, 4, 2, { NULL }, 0, 50, 24, 256 };
+int out_fd = -1;                        // Results; stdout itself carries the daemon log
+
+// --- TREE GENERATOR ---
+// Content is sparse: the stability walk only stats it
+static bool bench_sparse(const char* path, off_t size) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666); if (fd < 0) return false;
+    bool ok = ftruncate(fd, size) == 0;
+    return close(fd) == 0 && ok;
+}
+
+static size_t bench_param(char* buf, size_t cap, int n) {
+    size_t o = (size_t)snprintf(buf, cap,
+        "{\n  \"ageLevel\": {\"default\": 12, \"US\": 13},\n  \"applicationCategoryType\": 0,\n"
+        "  \"applicationDrmType\": \"%s\",\n  \"attribute\": 0,\n  \"attribute2\": 0,\n  \"attribute3\": 4,\n"
+        "  \"conceptId\": \"%d\",\n  \"contentBadgeType\": 0,\n  \"contentId\": \"UP9000-PPSA%05d_00-BENCHMARK%07d\",\n"
+        "  \"contentVersion\": \"01.000.000\",\n  \"downloadDataSize\": %d,\n  \"gameIntent\": {\"permittedIntents\": [{\"intentType\": \"launchApp\"}]},\n"
+        "  \"kernel\": {\"cpuPageTableSize\": 0, \"flexibleMemorySize\": 0, \"gpuPageTableSize\": 0},\n"
+        "  \"localizedParameters\": {\n    \"defaultLanguage\": \"en-US\"",
+        n % 25 == 0 ? "upgradable" : "standard", 10000 + n, n, n, 1048576 * (1 + n % 64));
+    for (int k = 0; BENCH_LOCALES[k] && o < cap; k++)
+        o += (size_t)snprintf(buf + o, cap - o, ",\n    \"%s\": {\"titleName\": \"Benchmark Title %d (%s)\"}", BENCH_LOCALES[k], n, BENCH_LOCALES[k]);
+    if (o < cap) o += (size_t)snprintf(buf + o, cap - o,
+        "\n  },\n  \"masterVersion\": \"01.00\",\n  \"originContentVersion\": \"01.000.000\",\n"
+        "  \"pubtools\": {\"creationDate\": \"2024-01-01 00:00:00\", \"loudnessSnd0\": \"-17.00\", \"submission\": false, \"toolVersion\": \"1.12.00.00\"},\n"
+        "  \"requiredSystemSoftwareVersion\": \"0x0400000000000000\",\n  \"sdkVersion\": \"0x0400000000000000\",\n"
+        "  \"titleId\": \"PPSA%05d\",\n  \"userDefinedParam1\": 0,\n  \"userDefinedParam2\": 0,\n  \"userDefinedParam3\": 0,\n  \"userDefinedParam4\": 0\n}\n", n);
+    return o < cap ? o : cap - 1;
+}
+
+time_t bench_old;   // Dumps look fully copied an hour ago
+
+// Dump number `n` under `root`; a `fresh` one keeps its real times, as if just copied in
+static bool bench_dump(const char* root, int n, bool fresh) {
+    static char* asset; static size_t asset_cap;
+    char dir[MAX_PATH - 64], path[MAX_PATH], param[16384]; // dir leaves room for the names below it
+    if (!path_fmt(dir, sizeof(dir), "%s/" BENCH_PREFIX "%05d", root, n)) return false;
+    snprintf(path, sizeof(path), "%s/sce_sys", dir);
+    if (!fixture_mkdirs(path)) return false;
+    snprintf(path, sizeof(path), "%s/sce_sys/param.json", dir);
+    if (!fixture_write(path, param, bench_param(param, sizeof(param), n))) return false;
+    for (int k = 0; BENCH_ASSETS[k].name; k++) {
+        size_t len = (size_t)BENCH_ASSETS[k].kb * opts.asset_kb * 1024 / 256;
+        if (len > asset_cap) {
+            char* na = (char*)realloc(asset, len); if (!na) return false;
+            for (size_t b = asset_cap; b < len; b++) na[b] = (char)(b * 131 + 7);
+            asset = na; asset_cap = len;
+        }
+        snprintf(path, sizeof(path), "%s/sce_sys/%s", dir, BENCH_ASSETS[k].name);
+        char* slash = strrchr(path, '/'); *slash = '\0'; fixture_mkdirs(path); *slash = '/';
+        if (!fixture_write(path, asset, len)) return false;
+    }
+    snprintf(path, sizeof(path), "%s/eboot.bin", dir); bench_sparse(path, 48ll << 20);
+    snprintf(path, sizeof(path), "%s/sce_module", dir); fixture_mkdirs(path);
+    snprintf(path, sizeof(path), "%s/sce_module/libc.prx", dir); bench_sparse(path, 1ll << 20);
+    for (int k = 0; k < opts.files; k++) {
+        snprintf(path, sizeof(path), "%s/data/%02d", dir, k % 4); fixture_mkdirs(path);
+        snprintf(path, sizeof(path), "%s/data/%02d/chunk%03d.bin", dir, k % 4, k);
+        bench_sparse(path, (off_t)(64 + (n * 7 + k * 13) % 960) << 20);
+    }
+    return fresh || fixture_backdate(dir, bench_old);
+}
+
+// --- SCENARIO SETUP ---
+char bench_drives[BENCH_MAX_DEVICES][MAX_PATH];
+int n_drives;
+char bench_roots[INTERNAL_ROOT_COUNT + BENCH_MAX_DEVICES * DEVICE_SUBDIR_COUNT][MAX_PATH]; // Where dumps go
+
+static void bench_teardown(void) {
+    fixture_teardown();
+    for (int k = 0; k < n_drives; k++) {
+        if (opts.n_devices) {
+            const char* subs[] = { "", "/homebrew", "/etaHEN/games", NULL };
+            for (int s = 0; subs[s]; s++) {
+                char root[MAX_PATH]; if (!path_fmt(root, sizeof(root), "%s%s", bench_drives[k], subs[s])) continue;
+                DIR* d = opendir(root); if (!d) continue;
+                struct dirent* e;
+                while ((e = readdir(d))) {
+                    if (strncmp(e->d_name, BENCH_PREFIX, strlen(BENCH_PREFIX)) != 0) continue;
+                    char dump[MAX_PATH]; if (!path_fmt(dump, sizeof(dump), "%s/%s", root, e->d_name)) continue;
+                    fixture_rm(dump);
+                }
+                closedir(d);
+            }
+        } else {
+            umount2(bench_drives[k], MNT_DETACH); rmdir(bench_drives[k]);
+        }
+    }
+}
+
+// Mounts fresh filesystems and spreads `count` dumps round-robin over every scan root.
+// Returns the number of roots used, or -1.
+static int bench_setup(int count) {
+    if (!fixture_setup()) return -1;
+    n_drives = opts.n_devices ? opts.n_devices : opts.drives;
+    for (int k = 0; k < n_drives; k++) {
+        if (opts.n_devices) snprintf(bench_drives[k], MAX_PATH, "%s", opts.devices[k]);
+        else { snprintf(bench_drives[k], MAX_PATH, MOUNT_PREFIX "smbench%d", k); if (!fixture_tmpfs(bench_drives[k])) return -1; }
+    }
+    int n_roots = 0;
+    for (int k = 0; k < INTERNAL_ROOT_COUNT; k++) snprintf(bench_roots[n_roots++], MAX_PATH, "%s", INTERNAL_ROOTS[k]);
+    for (int k = 0; k < n_drives; k++)
+        for (int s = 0; DEVICE_SUBDIRS[s]; s++) {
+            snprintf(bench_roots[n_roots], MAX_PATH, "%s%s", bench_drives[k], DEVICE_SUBDIRS[s]);
+            if (fixture_mkdirs(bench_roots[n_roots])) n_roots++;
+        }
+    bench_old = time(NULL) - 3600;
+    for (int n = 1; n <= count; n++)
+        if (!bench_dump(bench_roots[(n - 1) % n_roots], n, false)) { fprintf(stderr, "bench: dump %d: %s\n", n, strerror(errno)); return -1; }
+    return n_roots;
+}
+
+// --- MEASUREMENT ---
+struct BenchSample { double ms; uint64_t syscr, syscw, rchar, wchar, stats, parses, csw; };
+
+static void bench_sample(struct BenchSample* s) {
+    memset(s, 0, sizeof(*s));
+    s->ms = now_ms();
+    FILE* f = fopen("/proc/self/io", "r");
+    if (f) {
+        char key[32]; unsigned long long v;
+        while (fscanf(f, "%31[^:]: %llu\n", key, &v) == 2) {
+            if (!strcmp(key, "syscr")) s->syscr = v; else if (!strcmp(key, "syscw")) s->syscw = v;
+            else if (!strcmp(key, "rchar")) s->rchar = v; else if (!strcmp(key, "wchar")) s->wchar = v;
+        }
+        fclose(f);
+    }
+    struct rusage ru; getrusage(RUSAGE_SELF, &ru);
+    s->csw = (uint64_t)(ru.ru_nvcsw + ru.ru_nivcsw);
+    s->stats = metric_get(C_STAT_CALLS); s->parses = metric_get(C_PARAM_PARSES);
+}
+
+// Current and peak resident set from /proc/self/status
+static void bench_rss_kb(long* rss, long* hwm) {
+    *rss = *hwm = -1;
+    FILE* f = fopen("/proc/self/status", "r"); if (!f) return;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) { sscanf(line, "VmRSS: %ld", rss); sscanf(line, "VmHWM: %ld", hwm); }
+    fclose(f);
+}
+
+static void bench_report(int count, int n_roots, const char* phase, const struct BenchSample* a, int cycles, const char* extra) {
+    struct BenchSample b; bench_sample(&b);
+    long rss, hwm; bench_rss_kb(&rss, &hwm);
+    dprintf(out_fd, "{\"titles\": %d, \"roots\": %d, \"phase\": \"%s\", \"cycles\": %d, \"ms\": %.3f, \"ms_per_cycle\": %.3f, "
+                    "\"syscr\": %llu, \"syscw\": %llu, \"rchar\": %llu, \"wchar\": %llu, \"stat_calls\": %llu, \"param_parses\": %llu, "
+                    "\"ctx_switches\": %llu, \"rss_kb\": %ld, \"max_rss_kb\": %ld%s%s}\n",
+            count, n_roots, phase, cycles, b.ms - a->ms, cycles ? (b.ms - a->ms) / cycles : b.ms - a->ms,
+            (unsigned long long)(b.syscr - a->syscr), (unsigned long long)(b.syscw - a->syscw),
+            (unsigned long long)(b.rchar - a->rchar), (unsigned long long)(b.wchar - a->wchar),
+            (unsigned long long)(b.stats - a->stats), (unsigned long long)(b.parses - a->parses),
+            (unsigned long long)(b.csw - a->csw), rss, hwm, extra ? ", " : "", extra ? extra : "");
+}
+
+static int bench_done_titles(void) {
+    int done = 0;
+    for (size_t k = 0; k < cache_cap; k++) if (CACHE_LIVE(cache[k]) && cache[k]->stage == CAND_DONE) done++;
+    return done;
+}
+
+// First process: cold start through steady state. Leaves its index behind for warm_start.
+static void bench_cold(int count, int n_roots) {
+    fixture_daemon_init();
+    index_load();
+    struct BenchSample s; char extra[128];
+
+    bench_sample(&s);
+    int found = count_new_candidates(); index_save();
+    snprintf(extra, sizeof(extra), "\"found\": %d", found);
+    bench_report(count, n_roots, "startup_count", &s, 0, extra);
+
+    bench_sample(&s);
+    uint64_t regs0 = metric_get(C_REGISTRATIONS);
+    scan_all_paths(); install_drain(); install_reap();
+    snprintf(extra, sizeof(extra), "\"done\": %d, \"registrations\": %llu", bench_done_titles(),
+             (unsigned long long)(metric_get(C_REGISTRATIONS) - regs0));
+    bench_report(count, n_roots, "cold_scan", &s, 1, extra);
+
+    // Written before the phase starts, so it times settling rather than writing them
+    int fresh = count / 10 > 0 ? count / 10 : 1, total = count;
+    while (total < count + fresh && bench_dump(bench_roots[total % n_roots], total + 1, true)) total++;
+    bench_sample(&s);
+    uint64_t cycles0 = metric_get(C_SCAN_CYCLES); regs0 = metric_get(C_REGISTRATIONS);
+    int done0 = bench_done_titles();
+    double deadline = now_ms() + 60000.0 + total * 50.0;
+    while (bench_done_titles() < total && now_ms() < deadline) {
+        watcher_wait(watcher_idle_timeout(wheel_next_due_ms()));
+        scan_all_paths();
+    }
+    install_drain(); install_reap();
+    int done = bench_done_titles();
+    snprintf(extra, sizeof(extra), "\"fresh\": %d, \"done\": %d, \"registrations\": %llu, \"titles_per_s\": %.1f", total - count,
+             done, (unsigned long long)(metric_get(C_REGISTRATIONS) - regs0), (done - done0) / ((now_ms() - s.ms) / 1000.0));
+    bench_report(count, n_roots, "settle_install", &s, (int)(metric_get(C_SCAN_CYCLES) - cycles0), extra);
+
+    bench_sample(&s);
+    for (int k = 0; k < opts.cycles; k++) scan_all_paths();
+    bench_report(count, n_roots, "steady_idle", &s, opts.cycles, NULL);
+
+    int relists = opts.cycles / 5 > 0 ? opts.cycles / 5 : 1;
+    bench_sample(&s);
+    for (int k = 0; k < relists; k++) {
+        for (int i = 0; i < MAX_ROOTS; i++) {
+            if (!roots[i].active) continue;
+            memset(&roots[i].listed, 0, sizeof(roots[i].listed)); root_mark_dirty(i);
+        }
+        scan_all_paths();
+    }
+    bench_report(count, n_roots, "steady_relist", &s, relists, NULL);
+    install_drain(); index_save(); log_flush();
+}
+
+static void bench_warm(int count, int n_roots) {
+    fixture_daemon_init();
+    struct BenchSample s; char extra[64];
+    bench_sample(&s);
+    index_load();
+    int found = count_new_candidates();
+    snprintf(extra, sizeof(extra), "\"found\": %d, \"indexed\": %zu", found, cache_count);
+    bench_report(count, n_roots, "warm_start", &s, 0, extra);
+    log_flush();
+}
+
+// Runs `fn` in a fresh process so every phase starts from the daemon's initial state
+static bool bench_fork(void (*fn)(int, int), int count, int n_roots) {
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) { fn(count, n_roots); _exit(0); }
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void bench_usage(void) {
+    fprintf(stderr, "usage: shadowmount-bench [-n 10,100,1000,5000] [-d drives] [-c cycles] [-f files] [-a asset_kb] [--device /mnt/x]...\n");
+}
+
+int main(int argc, char** argv) {
+    for (int k = 1; k < argc; k++) {
+        const char* v = k + 1 < argc ? argv[k + 1] : NULL;
+        if (!v) { bench_usage(); return 2; }
+        if (!strcmp(argv[k], "-n")) {
+            opts.n_counts = 0;
+            for (char* p = argv[++k]; *p && opts.n_counts < BENCH_MAX_SCENARIOS; ) {
+                opts.counts[opts.n_counts++] = (int)strtol(p, &p, 10);
+                if (*p == ',') p++; else break;
+            }
+        }
+        else if (!strcmp(argv[k], "-d")) opts.drives = atoi(argv[++k]);
+        else if (!strcmp(argv[k], "-c")) opts.cycles = atoi(argv[++k]);
+        else if (!strcmp(argv[k], "-f")) opts.files = atoi(argv[++k]);
+        else if (!strcmp(argv[k], "-a")) opts.asset_kb = (unsigned)atoi(argv[++k]);
+        else if (!strcmp(argv[k], "--device") && opts.n_devices < BENCH_MAX_DEVICES) opts.devices[opts.n_devices++] = argv[++k];
+        else { bench_usage(); return 2; }
+    }
+    if (opts.drives < 0 || opts.drives > BENCH_MAX_DEVICES) opts.drives = 2;
+    out_fd = dup(STDOUT_FILENO);
+
+    for (int c = 0; c < opts.n_counts; c++) {
+        int count = opts.counts[c];
+        double t0 = now_ms();
+        int n_roots = bench_setup(count);
+        if (n_roots < 0) { bench_teardown(); return 1; }
+        fprintf(stderr, "bench: %d dump(s) over %d root(s) generated in %.0f ms\n", count, n_roots, now_ms() - t0);
+        bool ok = bench_fork(bench_cold, count, n_roots) && bench_fork(bench_warm, count, n_roots);
+        bench_teardown();
+        if (!ok) { fprintf(stderr, "bench: scenario %d failed\n", count); return 1; }
+    }
+    return 0;
+}
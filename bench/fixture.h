@@ -0,0 +1,95 @@
+// Host-only fixtures shared by bench/bench.c, bench/micro.c and tests/host_test.c: the tmpfs
+// sandbox over every path the daemon touches, a dump factory and the daemon bootstrap.
+// Include after main.c. The sandbox needs root with CAP_SYS_ADMIN, in a container or VM.
+#ifndef SHADOWMOUNT_FIXTURE_H
+#define SHADOWMOUNT_FIXTURE_H
+
+#include <ftw.h>
+
+// Every path the daemon touches; each gets a fresh tmpfs per scenario or test case
+const char* FIXTURE_TMPFS[] = { "/data/homebrew", "/data/etaHEN/games", LOG_DIR, "/user/app", "/user/appmeta", "/system_ex/app", NULL };
+
+// --- FILES ---
+bool fixture_mkdirs(const char* path) {
+    char p[MAX_PATH]; snprintf(p, sizeof(p), "%s", path);
+    for (char* s = p + 1; *s; s++) if (*s == '/') { *s = '\0'; mkdir(p, 0777); *s = '/'; }
+    return mkdir(p, 0777) == 0 || errno == EEXIST;
+}
+
+bool fixture_write(const char* path, const void* data, size_t len) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666); if (fd < 0) return false;
+    bool ok = write_all(fd, (const char*)data, len);
+    return close(fd) == 0 && ok;
+}
+
+static int fixture_rm_one(const char* path, const struct stat* st, int flag, struct FTW* ftw) {
+    (void)st; (void)ftw;
+    return flag == FTW_DP ? rmdir(path) : unlink(path);
+}
+
+// Removes `path` and everything below it
+bool fixture_rm(const char* path) { return nftw(path, fixture_rm_one, 16, FTW_PHYS | FTW_DEPTH) == 0; }
+
+time_t fixture_when; // nftw() callbacks take no context
+
+static int fixture_backdate_one(const char* path, const struct stat* st, int flag, struct FTW* ftw) {
+    (void)st; (void)flag; (void)ftw;
+    struct timespec ts[2] = { { fixture_when, 0 }, { fixture_when, 0 } };
+    utimensat(AT_FDCWD, path, ts, AT_SYMLINK_NOFOLLOW);
+    return 0;
+}
+
+// Sets the times of `dir` and everything below it to `when`, so a dump looks fully copied then
+bool fixture_backdate(const char* dir, time_t when) {
+    fixture_when = when;
+    return nftw(dir, fixture_backdate_one, 16, FTW_PHYS | FTW_DEPTH) == 0;
+}
+
+// --- DUMPS ---
+// A minimal dump at `dir` (param.json, icon0.png, eboot.bin) copied an hour ago, so it
+// settles after one complete walk
+bool fixture_dump(const char* dir, const char* title_id, const char* drm_type) {
+    char path[MAX_PATH], param[512];
+    if (!path_fmt(path, sizeof(path), "%s/sce_sys", dir) || !fixture_mkdirs(path)) return false;
+    int len = snprintf(param, sizeof(param),
+        "{\n  \"applicationDrmType\": \"%s\",\n  \"contentId\": \"UP9000-%s_00-TESTDUMP00000000\",\n"
+        "  \"contentVersion\": \"01.000.000\",\n  \"localizedParameters\": {\n    \"defaultLanguage\": \"en-US\",\n"
+        "    \"en-US\": {\"titleName\": \"Test %s\"}\n  },\n  \"titleId\": \"%s\"\n}\n",
+        drm_type, title_id, title_id, title_id);
+    const char* files[][2] = { { "sce_sys/param.json", param }, { "sce_sys/icon0.png", "png" }, { "eboot.bin", "elf" }, { NULL, NULL } };
+    for (int k = 0; files[k][0]; k++) {
+        if (!path_fmt(path, sizeof(path), "%s/%s", dir, files[k][0])) return false;
+        if (!fixture_write(path, files[k][1], k ? strlen(files[k][1]) : (size_t)len)) return false;
+    }
+    return fixture_backdate(dir, time(NULL) - 3600);
+}
+
+// --- SANDBOX ---
+bool fixture_tmpfs(const char* path) {
+    if (!fixture_mkdirs(path)) return false;
+    if (mount("tmpfs", path, "tmpfs", 0, "mode=0777") == 0) return true;
+    fprintf(stderr, "%s: tmpfs on %s: %s (needs root with CAP_SYS_ADMIN)\n", program_invocation_short_name, path, strerror(errno));
+    return false;
+}
+
+// Fresh tmpfs on every FIXTURE_TMPFS path. On failure the caller still runs fixture_teardown().
+bool fixture_setup(void) {
+    for (int k = 0; FIXTURE_TMPFS[k]; k++) if (!fixture_tmpfs(FIXTURE_TMPFS[k])) return false;
+    return true;
+}
+
+void fixture_teardown(void) {
+    for (int k = 0; FIXTURE_TMPFS[k]; k++) umount2(FIXTURE_TMPFS[k], MNT_DETACH);
+}
+
+// --- DAEMON ---
+// What main() does before its first scan. The daemon log keeps going to LOG_FILE; stdout,
+// which it also writes to, goes to /dev/null so it cannot mix into the caller's results.
+void fixture_daemon_init(void) {
+    int devnull = open("/dev/null", O_WRONLY); if (devnull >= 0) { dup2(devnull, STDOUT_FILENO); close(devnull); }
+    plat_init(); mkdir(LOG_DIR, 0777); log_start();
+    started_at = now_ms();
+    watcher_init(); install_start();
+}
+
+#endif
@@ -0,0 +1,407 @@
+// Microbenchmarks for the host build (make bench): daemon hot paths against the code they
+// replaced, run in-process without any tmpfs setup. One JSON object per case and
+// implementation on stdout; "old" is the baseline implementation, kept as it was below.
+//   json    param.json parse throughput in MB/s, from memory and from disk, on a retail-shaped
+//           file and a synthetic 5 MB one, plus every file named after the case (e.g. real
+//           dumps' param.json)
+//   copy    asset copy throughput in MB/s against the old 8 KB fopen/fread/fwrite loop, for a
+//           tree of many small files and for one large file, in a scratch directory under
+//           /tmp or the directory given (e.g. on a USB drive). Sources stay in the page
+//           cache; "new_unchanged" is a repeat copy that the differential check skips. On
+//           Linux the new path uses copy_file_range (mmap between filesystems it cannot copy
+//           across), the console takes the buffered loop.
+//   cache   GameCache lookup ns, hits and misses, at 100, 1,000 and 10,000 titles against the
+//           old linear strcmp scan (a fixed 512-slot array then, sized to fit here)
+//   log     log_debug() calls/s against the old logger (mkdir, fopen, localtime, fprintf
+//           and fclose per line), into a scratch directory under /tmp or the one given.
+//           "new" is what the caller sees; "new_flushed" waits until every line is on disk,
+//           and lines the ring dropped are counted.
+//
+//   shadowmount-micro [json [file...] | copy [dir] | cache | log [dir]]     (every case when none is given)
+#define main shadowmount_main
+#include "main.c"
+#undef main
+#include "fixture.h"
+
+#define MICRO_MIN_MS 300    // Each measurement repeats until it has run this long
+
+// Calls fn(arg) until MICRO_MIN_MS have passed. Returns the mean time per call in ms.
+static double micro_time(void (*fn)(void*), void* arg) {
+    fn(arg); // Warm caches and buffers
+    long calls = 0; double t0 = now_ms(), t;
+    do { fn(arg); calls++; } while ((t = now_ms()) - t0 < MICRO_MIN_MS);
+    return (t - t0) / calls;
+}
+
+// --- BASELINE ---
+// The extractor and DRM lookup as they ran on every probe before the single-pass parser
+static int old_extract_json_string(const char* json, const char* key, char* out, size_t out_size) {
+    char search[64]; snprintf(search, sizeof(search), "\"%s\"", key);
+    const char* p = strstr(json, search); if (!p) return -1;
+    p = strchr(p + strlen(search), ':'); if (!p) return -2;
+    while (*++p && isspace(*p)) { /*skip*/ } if (*p != '"') return -3; p++;
+    size_t i = 0; while (i < out_size - 1 && p[i] && p[i] != '"') { out[i] = p[i]; i++; } out[i] = '\0'; return 0;
+}
+
+static bool old_extract(const char* buf, char* out_id, char* out_name) {
+    int res = old_extract_json_string(buf, "titleId", out_id, MAX_TITLE_ID);
+    if (res != 0) res = old_extract_json_string(buf, "title_id", out_id, MAX_TITLE_ID);
+    if (res != 0) return false;
+    const char* en_ptr = strstr(buf, "\"en-US\""); const char* search_start = en_ptr ? en_ptr : buf;
+    if (old_extract_json_string(search_start, "titleName", out_name, MAX_TITLE_NAME) != 0) old_extract_json_string(buf, "titleName", out_name, MAX_TITLE_NAME);
+    if (strlen(out_name) == 0) strncpy(out_name, out_id, MAX_TITLE_NAME);
+    return true;
+}
+
+// Lookup half of fix_application_drm_type(); the rewrite is left out so real files given
+// on the command line are never modified
+static int old_find_drm_type(const char* buf) {
+    const char* key = "\"applicationDrmType\""; const char* p = strstr(buf, key);
+    if (!p) return 0;
+    const char* colon = strchr(p + strlen(key), ':'); const char* q1 = colon ? strchr(colon, '"') : NULL; const char* q2 = q1 ? strchr(q1 + 1, '"') : NULL;
+    if (!q1 || !q2) return -1;
+    return ((q2 - q1 - 1) == (long)strlen("standard") && !strncmp(q1 + 1, "standard", strlen("standard"))) ? 0 : 1;
+}
+
+static int old_fix_application_drm_type(const char* path) {
+    FILE* f = fopen(path, "rb+"); if (!f) return -1;
+    fseek(f, 0, SEEK_END); long len = ftell(f); fseek(f, 0, SEEK_SET);
+    if (len <= 0 || len > 1024 * 1024 * 5) { fclose(f); return -1; }
+    char* buf = (char*)malloc(len + 1); (void)!fread(buf, 1, len, f); buf[len] = '\0';
+    int res = old_find_drm_type(buf);
+    free(buf); fclose(f); return res;
+}
+
+static bool old_get_game_info(const char* base_path, char* out_id, char* out_name) {
+    char path[MAX_PATH]; snprintf(path, sizeof(path), "%s/sce_sys/param.json", base_path);
+    old_fix_application_drm_type(path);
+    FILE* f = fopen(path, "rb");
+    if (f) {
+        fseek(f, 0, SEEK_END); long len = ftell(f); fseek(f, 0, SEEK_SET);
+        if (len > 0) {
+            char* buf = (char*)malloc(len + 1);
+            if (buf) {
+                (void)!fread(buf, 1, len, f); buf[len] = '\0';
+                bool ok = old_extract(buf, out_id, out_name);
+                free(buf); fclose(f); return ok;
+            }
+        }
+        fclose(f);
+    }
+    return false;
+}
+
+// The copy loops as they ran for every install before the copy engine
+static int old_copy_dir(const char* src, const char* dst) {
+    mkdir(dst, 0777); DIR* d = opendir(src); if (!d) return -1;
+    struct dirent* e; char ss[MAX_PATH], dd[MAX_PATH]; struct stat st;
+    while ((e = readdir(d))) {
+        if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+        snprintf(ss, sizeof(ss), "%s/%s", src, e->d_name); snprintf(dd, sizeof(dd), "%s/%s", dst, e->d_name);
+        if (stat(ss, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) old_copy_dir(ss, dd);
+        else {
+            FILE* fs = fopen(ss, "rb"); if (!fs) continue;
+            FILE* fd = fopen(dd, "wb"); if (!fd) { fclose(fs); continue; }
+            char buf[8192]; size_t n; while ((n = fread(buf, 1, sizeof(buf), fs)) > 0) fwrite(buf, 1, n, fd);
+            fclose(fd); fclose(fs);
+        }
+    }
+    closedir(d); return 0;
+}
+
+static int old_copy_file(const char* src, const char* dst) {
+    char buf[8192]; FILE* fs = fopen(src, "rb"); if (!fs) return -1;
+    FILE* fd = fopen(dst, "wb"); if (!fd) { fclose(fs); return -1; }
+    size_t n; while ((n = fread(buf, 1, sizeof(buf), fs)) > 0) fwrite(buf, 1, n, fd);
+    fclose(fd); fclose(fs); return 0;
+}
+
+// The logger as it was: stdout, then reopen the file for every line. It read `args` twice;
+// the copy here keeps that defined.
+char old_log_dir[MAX_PATH], old_log_file[MAX_PATH];
+
+static void old_log_to_file(const char* fmt, va_list args) {
+    mkdir(old_log_dir, 0777);
+    FILE* fp = fopen(old_log_file, "a");
+    if (fp) {
+        time_t rawtime; struct tm * timeinfo; char buffer[80];
+        time(&rawtime); timeinfo = localtime(&rawtime); strftime(buffer, sizeof(buffer), "%H:%M:%S", timeinfo);
+        fprintf(fp, "[%s] ", buffer); vfprintf(fp, fmt, args); fprintf(fp, "\n"); fclose(fp);
+    }
+}
+
+static void old_log_debug(const char* fmt, ...) {
+    va_list args, file_args; va_start(args, fmt); va_copy(file_args, args);
+    vprintf(fmt, args); printf("\n"); old_log_to_file(fmt, file_args);
+    va_end(file_args); va_end(args);
+}
+
+// The title cache as it was: an array walked with strcmp for every directory entry
+struct OldGameCache { char path[MAX_PATH]; char title_id[MAX_TITLE_ID]; char title_name[MAX_TITLE_NAME]; bool valid; };
+
+static bool old_cache_seen(const struct OldGameCache* cache, int max_pending, const char* full_path) {
+    bool already_seen = false;
+    for(int k=0; k<max_pending; k++) {
+        if (cache[k].valid && strcmp(cache[k].path, full_path) == 0) { already_seen = true; break; }
+    }
+    return already_seen;
+}
+
+// --- JSON ---
+// "buffer" times the parse of a file already in memory, "file" a whole probe from the open()
+// on, which for the old code includes the second read done by the DRM check.
+struct MicroJson { const char* buf; size_t len; const char* dir; struct ParamInfo info; char old_id[MAX_TITLE_ID], old_name[MAX_TITLE_NAME]; };
+
+static void micro_json_new(void* arg) { struct MicroJson* m = (struct MicroJson*)arg; parse_param_json(m->buf, m->len, &m->info); }
+static void micro_json_old(void* arg) { struct MicroJson* m = (struct MicroJson*)arg; old_find_drm_type(m->buf); old_extract(m->buf, m->old_id, m->old_name); }
+static void micro_json_new_file(void* arg) { struct MicroJson* m = (struct MicroJson*)arg; get_game_info(m->dir, &m->info); }
+static void micro_json_old_file(void* arg) { struct MicroJson* m = (struct MicroJson*)arg; old_get_game_info(m->dir, m->old_id, m->old_name); }
+
+static void micro_json_report(const char* input, const char* mode, const char* impl, size_t len, double ms, const char* title_id) {
+    printf("{\"case\": \"json\", \"input\": \"%s\", \"mode\": \"%s\", \"bytes\": %zu, \"impl\": \"%s\", \"us_per_call\": %.3f, \"mb_s\": %.1f, \"title_id\": \"%s\"}\n",
+           input, mode, len, impl, ms * 1000.0, len / 1e3 / ms, title_id);
+}
+
+// `buf` must be NUL-terminated for the old code. Copies it to a scratch dump for the file mode.
+static void micro_json_run(const char* input, const char* buf, size_t len) {
+    struct MicroJson m; memset(&m, 0, sizeof(m)); m.buf = buf; m.len = len;
+    if (!parse_param_json(buf, len, &m.info)) fprintf(stderr, "micro: %s: incomplete or malformed JSON\n", input);
+    micro_json_report(input, "buffer", "old", len, micro_time(micro_json_old, &m), m.old_id);
+    micro_json_report(input, "buffer", "new", len, micro_time(micro_json_new, &m), m.info.title_id);
+
+    char dir[] = "/tmp/smmicro.XXXXXX", path[MAX_PATH];
+    if (!mkdtemp(dir)) return;
+    snprintf(path, sizeof(path), "%s/sce_sys", dir); mkdir(path, 0777);
+    snprintf(path, sizeof(path), "%s/sce_sys/param.json", dir);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    bool ok = fd >= 0 && write_all(fd, buf, len);
+    if (fd >= 0) close(fd);
+    if (ok) { // `buf` may be param_buf, which get_game_info() overwrites: not used from here on
+        m.dir = dir;
+        micro_json_report(input, "file", "old", len, micro_time(micro_json_old_file, &m), m.old_id);
+        micro_json_report(input, "file", "new", len, micro_time(micro_json_new_file, &m), m.info.title_id);
+    }
+    remove(path);
+    snprintf(path, sizeof(path), "%s/sce_sys", dir); rmdir(path); rmdir(dir);
+}
+
+// Retail layout: the fields the daemon reads are spread over ~3 KB, titleId near the end
+static size_t micro_retail_param(char* buf, size_t cap) {
+    static const char* locales[] = { "ar-AE", "de-DE", "en-GB", "en-US", "es-419", "es-ES", "fr-CA", "fr-FR", "it-IT", "ja-JP",
+                                     "ko-KR", "nl-NL", "pl-PL", "pt-BR", "ru-RU", "zh-Hans", "zh-Hant", NULL };
+    size_t o = (size_t)snprintf(buf, cap,
+        "{\n  \"ageLevel\": {\"default\": 12, \"US\": 13},\n  \"applicationCategoryType\": 0,\n  \"applicationDrmType\": \"standard\",\n"
+        "  \"contentId\": \"UP9000-PPSA01234_00-MICROBENCHMARK00\",\n  \"contentVersion\": \"01.000.000\",\n"
+        "  \"gameIntent\": {\"permittedIntents\": [{\"intentType\": \"launchApp\"}]},\n"
+        "  \"kernel\": {\"cpuPageTableSize\": 0, \"flexibleMemorySize\": 0, \"gpuPageTableSize\": 0},\n"
+        "  \"localizedParameters\": {\n    \"defaultLanguage\": \"en-US\"");
+    for (int k = 0; locales[k] && o < cap; k++)
+        o += (size_t)snprintf(buf + o, cap - o, ",\n    \"%s\": {\"titleName\": \"Microbenchmark \\\"Title\\\" \\u00e9dition (%s)\"}", locales[k], locales[k]);
+    if (o < cap) o += (size_t)snprintf(buf + o, cap - o,
+        "\n  },\n  \"masterVersion\": \"01.00\",\n"
+        "  \"pubtools\": {\"creationDate\": \"2024-01-01 00:00:00\", \"loudnessSnd0\": \"-17.00\", \"submission\": false, \"toolVersion\": \"1.12.00.00\"},\n"
+        "  \"requiredSystemSoftwareVersion\": \"0x0400000000000000\",\n  \"sdkVersion\": \"0x0400000000000000\",\n"
+        "  \"titleId\": \"PPSA01234\",\n  \"userDefinedParam1\": 0\n}\n");
+    return o < cap ? o : cap - 1;
+}
+
+// Just under PARAM_MAX_SIZE: thousands of locales with escaped names, en-US and titleId last
+static size_t micro_huge_param(char* buf, size_t cap) {
+    size_t o = (size_t)snprintf(buf, cap, "{\"applicationDrmType\": \"standard\", \"contentId\": \"X\", \"localizedParameters\": {\"defaultLanguage\": \"en-US\"");
+    for (int k = 0; o + 256 < cap; k++)
+        o += (size_t)snprintf(buf + o, cap - o, ", \"l%d\": {\"titleName\": \"Some \\\"long\\\" title %d\", \"x\": [1, 2, 3]}", k, k);
+    o += (size_t)snprintf(buf + o, cap - o, ", \"en-US\": {\"titleName\": \"English\"}}, \"titleId\": \"PPSA99999\"}");
+    return o;
+}
+
+static int micro_json(int argc, char** argv) {
+    size_t cap = PARAM_MAX_SIZE + 1;
+    char* buf = (char*)malloc(cap); if (!buf) return 1;
+    micro_json_run("retail", buf, micro_retail_param(buf, cap));
+    micro_json_run("synthetic_5mb", buf, micro_huge_param(buf, cap - 64));
+    for (int k = 0; k < argc; k++) {
+        long len = read_param_file(argv[k]); // Into param_buf, NUL-terminated for the old code
+        if (len <= 0) { fprintf(stderr, "micro: %s: unreadable or over %d bytes\n", argv[k], PARAM_MAX_SIZE); continue; }
+        micro_json_run(argv[k], param_buf, (size_t)len);
+    }
+    free(buf);
+    return 0;
+}
+
+// --- COPY ---
+#define MICRO_COPY_SMALL    400         // Files in the small-file tree, 4..260 KB each
+#define MICRO_COPY_LARGE_MB 256
+#define MICRO_COPY_RUNS     3
+
+static bool micro_fill(const char* path, size_t len) {
+    static char chunk[1 << 16];
+    if (!chunk[1]) for (size_t b = 0; b < sizeof(chunk); b++) chunk[b] = (char)(b * 131 + 7);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666); if (fd < 0) return false;
+    bool ok = true;
+    for (size_t done = 0; ok && done < len; done += sizeof(chunk))
+        ok = write_all(fd, chunk, len - done < sizeof(chunk) ? len - done : sizeof(chunk));
+    return close(fd) == 0 && ok;
+}
+
+// One copy of `src` to `dst` (a tree if `dir`), in ms. impl: 0 old, 1 new, 2 new over an
+// up-to-date destination.
+static double micro_copy_once(const char* src, const char* dst, bool dir, int impl, struct CopyStats* cs) {
+    if (impl != 2) fixture_rm(dst);
+    sync();
+    double t0 = now_ms();
+    if (impl == 0) { if (dir) old_copy_dir(src, dst); else old_copy_file(src, dst); }
+    else { memset(cs, 0, sizeof(*cs)); if (dir) copy_dir(src, dst, cs); else copy_file(src, dst, cs); }
+    return now_ms() - t0;
+}
+
+static void micro_copy_run(const char* input, const char* src, const char* dst, bool dir, uint64_t bytes, uint32_t files) {
+    static const char* impls[] = { "old", "new", "new_unchanged" };
+    for (int impl = 0; impl < 3; impl++) {
+        struct CopyStats cs; memset(&cs, 0, sizeof(cs));
+        double best = -1;
+        for (int r = 0; r < MICRO_COPY_RUNS; r++) {
+            double ms = micro_copy_once(src, dst, dir, impl, &cs);
+            if (best < 0 || ms < best) best = ms;
+        }
+        printf("{\"case\": \"copy\", \"input\": \"%s\", \"files\": %u, \"bytes\": %llu, \"impl\": \"%s\", \"ms\": %.3f, \"mb_s\": %.1f, \"copied\": %u, \"errors\": %u}\n",
+               input, files, (unsigned long long)bytes, impls[impl], best, best > 0 ? bytes / 1048576.0 / (best / 1000.0) : 0.0,
+               impl ? cs.files : files, cs.errors);
+    }
+    fixture_rm(dst);
+}
+
+static int micro_copy(int argc, char** argv) {
+    char base[MAX_PATH - 64], src[MAX_PATH - 32], dst[MAX_PATH], path[MAX_PATH]; // Each leaves room for the names below it
+    snprintf(base, sizeof(base), "%s/smmicro.XXXXXX", argc > 0 ? argv[0] : "/tmp");
+    if (!mkdtemp(base)) { fprintf(stderr, "micro: %s: %s\n", base, strerror(errno)); return 1; }
+
+    // sce_sys-like tree: a few subfolders of small files
+    snprintf(src, sizeof(src), "%s/small", base); mkdir(src, 0777);
+    uint64_t bytes = 0; bool ok = true;
+    for (int k = 0; ok && k < MICRO_COPY_SMALL; k++) {
+        snprintf(path, sizeof(path), "%s/%02d", src, k % 8); mkdir(path, 0777);
+        snprintf(path, sizeof(path), "%s/%02d/file%03d.bin", src, k % 8, k);
+        size_t len = (size_t)(4 + (k * 37) % 257) * 1024;
+        ok = micro_fill(path, len); bytes += len;
+    }
+    snprintf(dst, sizeof(dst), "%s/small_copy", base);
+    if (ok) micro_copy_run("small_files", src, dst, true, bytes, MICRO_COPY_SMALL);
+
+    snprintf(src, sizeof(src), "%s/large.bin", base);
+    if (ok) ok = micro_fill(src, (size_t)MICRO_COPY_LARGE_MB << 20);
+    snprintf(dst, sizeof(dst), "%s/large_copy.bin", base);
+    if (ok) micro_copy_run("large_file", src, dst, false, (uint64_t)MICRO_COPY_LARGE_MB << 20, 1);
+
+    if (!ok) fprintf(stderr, "micro: could not create the copy sources under %s\n", base);
+    fixture_rm(base);
+    return ok ? 0 : 1;
+}
+
+// --- CACHE ---
+#define MICRO_CACHE_MAX 10000
+struct MicroCache { int n; char (*hit)[MAX_PATH]; char (*miss)[MAX_PATH]; struct OldGameCache* old; long found; };
+
+// Every cached title once, then as many paths that are not cached
+static void micro_cache_new(void* arg) {
+    struct MicroCache* m = (struct MicroCache*)arg;
+    for (int k = 0; k < m->n; k++) m->found += cache_find(m->hit[k]) != NULL;
+    for (int k = 0; k < m->n; k++) m->found += cache_find(m->miss[k]) != NULL;
+}
+
+static void micro_cache_old(void* arg) {
+    struct MicroCache* m = (struct MicroCache*)arg;
+    for (int k = 0; k < m->n; k++) m->found += old_cache_seen(m->old, m->n, m->hit[k]);
+    for (int k = 0; k < m->n; k++) m->found += old_cache_seen(m->old, m->n, m->miss[k]);
+}
+
+static int micro_cache(int argc, char** argv) {
+    (void)argc; (void)argv;
+    static const int sizes[] = { 100, 1000, MICRO_CACHE_MAX };
+    struct MicroCache m; memset(&m, 0, sizeof(m));
+    m.hit = (char (*)[MAX_PATH])calloc(MICRO_CACHE_MAX, MAX_PATH); m.miss = (char (*)[MAX_PATH])calloc(MICRO_CACHE_MAX, MAX_PATH);
+    m.old = (struct OldGameCache*)calloc(MICRO_CACHE_MAX, sizeof(*m.old));
+    if (!m.hit || !m.miss || !m.old) return 1;
+    for (int k = 0; k < MICRO_CACHE_MAX; k++) { // Titles spread over drives, like a large library
+        snprintf(m.hit[k], MAX_PATH, "/mnt/usb%d/homebrew/PPSA%05d-app", k % 8, k);
+        snprintf(m.miss[k], MAX_PATH, "/mnt/usb%d/homebrew/PPSA%05d-patch", k % 8, k);
+    }
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (; m.n < sizes[s]; m.n++) {
+            cache_insert(m.hit[m.n], "PPSA00000", "Title");
+            snprintf(m.old[m.n].path, MAX_PATH, "%s", m.hit[m.n]); m.old[m.n].valid = true;
+        }
+        double old_ns = micro_time(micro_cache_old, &m) * 1e6 / (2.0 * m.n), new_ns = micro_time(micro_cache_new, &m) * 1e6 / (2.0 * m.n);
+        printf("{\"case\": \"cache\", \"titles\": %d, \"impl\": \"old\", \"ns_per_lookup\": %.1f}\n", m.n, old_ns);
+        printf("{\"case\": \"cache\", \"titles\": %d, \"impl\": \"new\", \"ns_per_lookup\": %.1f, \"slots\": %zu}\n", m.n, new_ns, cache_cap);
+    }
+    free(m.hit); free(m.miss); free(m.old);
+    return 0;
+}
+
+// --- LOG ---
+#define MICRO_LOG_LINES 200000
+
+static unsigned long micro_count_lines(const char* path) {
+    unsigned long lines = 0; char buf[65536]; ssize_t n;
+    int fd = open(path, O_RDONLY); if (fd < 0) return 0;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) for (ssize_t k = 0; k < n; k++) lines += buf[k] == '\n';
+    close(fd);
+    return lines;
+}
+
+static void micro_log_report(const char* impl, double ms, unsigned long lines) {
+    printf("{\"case\": \"log\", \"impl\": \"%s\", \"calls\": %d, \"ms\": %.3f, \"calls_s\": %.0f, \"lines_written\": %lu, \"dropped\": %lu}\n",
+           impl, MICRO_LOG_LINES, ms, MICRO_LOG_LINES / (ms / 1000.0), lines, MICRO_LOG_LINES - lines);
+}
+
+static int micro_log(int argc, char** argv) {
+    snprintf(old_log_dir, sizeof(old_log_dir), "%s/smmicro.XXXXXX", argc > 0 ? argv[0] : "/tmp");
+    if (!mkdtemp(old_log_dir)) { fprintf(stderr, "micro: %s: %s\n", old_log_dir, strerror(errno)); return 1; }
+    char new_log_file[MAX_PATH];
+    if (!path_fmt(old_log_file, sizeof(old_log_file), "%s/old.log", old_log_dir) || !path_fmt(new_log_file, sizeof(new_log_file), "%s/new.log", old_log_dir)) {
+        fprintf(stderr, "micro: %s: path too long\n", old_log_dir); rmdir(old_log_dir); return 1;
+    }
+
+    // Both loggers echo every line to stdout: send that to /dev/null, results go to the saved fd
+    fflush(stdout);
+    int out = dup(STDOUT_FILENO), devnull = open("/dev/null", O_WRONLY);
+    if (out < 0 || devnull < 0) return 1;
+    dup2(devnull, STDOUT_FILENO); close(devnull);
+
+    double t0 = now_ms();
+    for (int k = 0; k < MICRO_LOG_LINES; k++) old_log_debug("  [PARAM] PPSA%05d: Some Game Title %d (01.000.000 v%d)", k, k, k);
+    fflush(stdout);
+    double old_ms = now_ms() - t0;
+
+    log_fd = open(new_log_file, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666); // log_open() keeps it
+    log_start();
+    t0 = now_ms();
+    for (int k = 0; k < MICRO_LOG_LINES; k++) log_debug("  [PARAM] PPSA%05d: Some Game Title %d (01.000.000 v%d)", k, k, k);
+    double new_ms = now_ms() - t0;
+    log_flush();
+    double flushed_ms = now_ms() - t0;
+
+    fflush(stdout); dup2(out, STDOUT_FILENO); close(out);
+    micro_log_report("old", old_ms, micro_count_lines(old_log_file));
+    unsigned long lines = micro_count_lines(new_log_file);
+    micro_log_report("new", new_ms, lines);
+    micro_log_report("new_flushed", flushed_ms, lines);
+    fixture_rm(old_log_dir);
+    return 0;
+}
+
+// --- DRIVER ---
+struct MicroCase { const char* name; int (*fn)(int argc, char** argv); };
+const struct MicroCase MICRO_CASES[] = { { "json", micro_json }, { "copy", micro_copy }, { "cache", micro_cache }, { "log", micro_log }, { NULL, NULL } };
+
+int main(int argc, char** argv) {
+    int rc = 0;
+    for (int k = 0; MICRO_CASES[k].name; k++) {
+        if (argc > 1 && strcmp(argv[1], MICRO_CASES[k].name) != 0) continue;
+        rc |= MICRO_CASES[k].fn(argc > 1 ? argc - 2 : 0, argv + 2);
+        if (argc > 1) return rc;
+    }
+    if (argc > 1) { fprintf(stderr, "usage: shadowmount-micro [json [file...] | copy [dir] | cache | log [dir]]\n"); return 2; }
+    return rc;
+}
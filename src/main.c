@@ -1,3 +1,6 @@
+#ifdef __linux__
+#define _GNU_SOURCE // copy_file_range, inotify_init1
+#endif
 #include <dirent.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,16 +13,44 @@
 #include <sys/mount.h>
 #include <sys/param.h>
 #include <sys/uio.h>
+#include <sys/mman.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
 #include <sys/syscall.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/statvfs.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#else
+#include <sys/event.h>
+#endif
 
-#include <ps5/kernel.h> 
+#include "platform.h"
 
 // --- Configuration ---
 #define SCAN_INTERVAL_US    3000000 
-#define MAX_PENDING         512     
+#define CACHE_MIN_SLOTS     512     // Power of two
+#define SETTLE_SECS         10      // A dump untouched this long counts as fully copied
+#define SETTLE_RECHECK_MS   1000    // Minimum delay between stability checks of one title
+#define WALK_BUDGET         16384   // stat() calls per scan cycle for sampling settling dumps
+#define WALK_TOP_FILES      4       // Largest files re-checked between full walks
+#define COPY_BUF_SIZE       (1024 * 1024)
+#define COPY_ALIGN          4096
+#define SYNC_VERIFY_HASH    0       // 1: same-size files with different mtimes are hashed before recopying
+#define INSTALL_WORKERS     4       // Threads copying assets and registering titles
+#define JOBS_PER_INTERNAL   2       // Concurrent installs reading from the internal SSD
+#define JOBS_PER_DEVICE     1       // ... and from each external drive (one seek-bound disk)
+#define REG_WAIT_MAX_MS     200     // Longest wait for a registration to show up in appmeta
+#define REG_POLL_MIN_MS     2       // First completion poll; doubles up to REG_POLL_MAX_MS
+#define REG_POLL_MAX_MS     32
+#define NEG_SETTLE_SECS     3       // Don't trust dir mtimes younger than this (exFAT has 2s granularity)
 #define MAX_PATH            1024
 #define MAX_TITLE_ID        32
 #define MAX_TITLE_NAME      256
@@ -28,220 +59,1918 @@
 #define LOCK_FILE           "/data/shadowmount/daemon.lock"
 #define KILL_FILE           "/data/shadowmount/STOP"
 #define TOAST_FILE          "/data/shadowmount/notify.txt"
-#define IOVEC_ENTRY(x) { (void*)(x), (x) ? strlen(x) + 1 : 0 }
+#define CONTROL_SOCK        "/data/shadowmount/control.sock"
+#define METRICS_FILE        "/data/shadowmount/metrics.prom"
+#define METRICS_WRITE_SECS  10      // Minimum interval between snapshot rewrites during scans
+#define INDEX_FILE          "/data/shadowmount/index.bin"
+#define INDEX_STALE_SECS    (30 * 24 * 3600) // Forget titles not seen for 30 days
 #define IOVEC_SIZE(x)  (sizeof(x) / sizeof(struct iovec))
 
-// --- SDK Imports ---
-int sceAppInstUtilInitialize(void);
-int sceAppInstUtilAppInstallTitleDir(const char* title_id, const char* install_path, void* reserved);
-int sceKernelUsleep(unsigned int microseconds);
-int sceUserServiceInitialize(void*);
-void sceUserServiceTerminate(void);
+// Fields pulled out of sce_sys/param.json
+struct ParamInfo {
+    char title_id[MAX_TITLE_ID];
+    char title_name[MAX_TITLE_NAME];
+    char content_id[64];
+    char version[32];
+    char drm_type[32];
+    long drm_off, drm_len;  // applicationDrmType value inside the file buffer, drm_off < 0 if absent or not looked for
+};
 
 // --- Forward Declarations ---
-bool get_game_info(const char* base_path, char* out_id, char* out_name);
+bool get_game_info(const char* base_path, struct ParamInfo* info);
 bool is_installed(const char* title_id);
 bool is_data_mounted(const char* title_id);
 void notify_system(const char* fmt, ...);
 void log_debug(const char* fmt, ...);
+double now_ms(void);
+struct GameCache;
+void walk_free(struct GameCache* e);
+void metrics_save(void);
+void metrics_tick(void);
+double pending_next_due_ms(void);
+
+// Scan Roots
+// Internal folders are always scanned. Every mounted storage device (see DEVICES)
+// contributes its root plus these subfolders.
+const char* INTERNAL_ROOTS[] = { "/data/homebrew", "/data/etaHEN/games", NULL };
+const char* DEVICE_SUBDIRS[] = { "/homebrew", "/etaHEN/games", "", NULL };
+#define INTERNAL_ROOT_COUNT 2
+#define DEVICE_SUBDIR_COUNT 3
+#define MAX_DEVICES         16
+#define MAX_ROOTS           (INTERNAL_ROOT_COUNT + MAX_DEVICES * DEVICE_SUBDIR_COUNT)
+#define DEVICE_ROOT(dev, sub) (INTERNAL_ROOT_COUNT + (dev) * DEVICE_SUBDIR_COUNT + (sub))
+
+// Mounts directly under this prefix with one of these filesystems count as game storage
+#define MOUNT_PREFIX        "/mnt/"
+const char* STORAGE_FSTYPES[] = {
+#ifdef __linux__
+    "ext4", "ext3", "ext2", "xfs", "btrfs", "vfat", "exfat", "ntfs3", "fuseblk", "tmpfs",
+#else
+    "exfatfs", "msdosfs", "ufs", "ntfs",
+#endif
+    NULL
+};
+
+struct GameCache { 
+    char path[MAX_PATH]; 
+    char title_id[MAX_TITLE_ID]; 
+    char title_name[MAX_TITLE_NAME]; 
+    uint32_t hash;
+    // param.json fingerprint: metadata is reused without parsing while it matches
+    uint64_t dev, ino;
+    int64_t mtime, size;
+    uint64_t dir_dev, dir_ino;  // The dump directory as last probed
+    uint64_t mnt_dev, mnt_ino;  // ... when it was last mounted, 0 if not mounted by the daemon
+    time_t last_seen;
+    uint8_t install_state;
+    uint8_t drm_state;  // Outcome of the one-time applicationDrmType migration
+    int8_t root;        // roots[] index it was found under, -1 if unknown
+    bool seen;          // Already handled by scan_all_paths() this session
+    uint32_t listed_gen;// Scan generation (neg_gen) that last found it under its root
+    // Candidate state machine (CAND_*), times in ms on the monotonic clock
+    uint8_t stage;
+    uint8_t retries;    // Failed install attempts since it was last discovered
+    double discovered_at, stage_at;
+    double changed_at;  // Root change that led to discovery, kept across wheel rechecks
+    // Timer wheel linkage while settling
+    struct GameCache* wheel_next;
+    uint64_t due_tick;
+    bool scheduled;
+    struct TreeWalk* walk;  // Incremental content sample while settling
+};
+enum { INST_UNKNOWN, INST_MOUNTED, INST_FAILED };
+enum { DRM_UNCHECKED, DRM_CLEAN, DRM_PATCHED, DRM_FAILED };
+enum { CAND_NONE, CAND_DISCOVERED, CAND_SETTLING, CAND_STABLE, CAND_RETRY_WAIT, CAND_INSTALLING, CAND_DONE };
+const char* CAND_NAMES[] = { "none", "discovered", "settling", "stable", "retry_wait", "installing", "done" };
+const char* INST_NAMES[] = { "unknown", "mounted", "failed" };
+const char* DRM_NAMES[] = { "unchecked", "clean", "patched", "failed" };
+
+// Open-addressing table (linear probing) keyed on the full path
+#define CACHE_TOMBSTONE ((struct GameCache*)1)
+#define CACHE_LIVE(e)   ((e) != NULL && (e) != CACHE_TOMBSTONE)
+struct GameCache** cache;
+size_t cache_cap, cache_count, cache_used; // used = live + tombstones
+
+// --- TIMER WHEEL ---
+// Settling candidates are parked in a hashed timer wheel (1 s ticks) and rechecked on
+// their own schedule instead of blocking the scan loop. Deadlines past one revolution
+// simply stay in their slot until their tick comes round.
+#define WHEEL_SLOTS     64
+#define WHEEL_TICK_MS   1000
+struct GameCache* wheel[WHEEL_SLOTS];
+uint64_t wheel_tick;    // Last tick that was expired
+size_t wheel_count;
+
+static uint64_t wheel_now_tick(void) { return (uint64_t)(now_ms() / WHEEL_TICK_MS); }
+
+void wheel_cancel(struct GameCache* e) {
+    if (!e->scheduled) return;
+    for (struct GameCache** pp = &wheel[e->due_tick % WHEEL_SLOTS]; *pp; pp = &(*pp)->wheel_next) {
+        if (*pp == e) { *pp = e->wheel_next; break; }
+    }
+    e->wheel_next = NULL; e->scheduled = false; wheel_count--;
+}
+
+void wheel_schedule(struct GameCache* e, double delay_ms) {
+    wheel_cancel(e);
+    if (!wheel_count) wheel_tick = wheel_now_tick();
+    uint64_t due = (uint64_t)((now_ms() + delay_ms + WHEEL_TICK_MS - 1) / WHEEL_TICK_MS); // Round up to a tick
+    if (due <= wheel_tick) due = wheel_tick + 1;
+    e->due_tick = due; e->scheduled = true;
+    e->wheel_next = wheel[due % WHEEL_SLOTS]; wheel[due % WHEEL_SLOTS] = e; wheel_count++;
+}
+
+// Unlinks every entry whose tick has passed into `out` (up to `max`). Returns the count.
+size_t wheel_expire(struct GameCache** out, size_t max) {
+    size_t n = 0;
+    if (!wheel_count) return 0;
+    uint64_t now = wheel_now_tick();
+    uint64_t from = (now - wheel_tick >= WHEEL_SLOTS) ? now - WHEEL_SLOTS + 1 : wheel_tick + 1;
+    for (uint64_t t = from; t <= now && n < max; t++) {
+        for (struct GameCache** pp = &wheel[t % WHEEL_SLOTS]; *pp && n < max; ) {
+            struct GameCache* e = *pp;
+            if (e->due_tick > now) { pp = &e->wheel_next; continue; }
+            *pp = e->wheel_next; e->wheel_next = NULL; e->scheduled = false; wheel_count--;
+            out[n++] = e;
+        }
+        if (n < max) wheel_tick = t;
+    }
+    return n;
+}
+
+// Milliseconds until the earliest scheduled entry is due, or -1 if none.
+double wheel_next_due_ms(void) {
+    if (!wheel_count) return -1;
+    uint64_t best = UINT64_MAX;
+    for (int s = 0; s < WHEEL_SLOTS; s++)
+        for (struct GameCache* e = wheel[s]; e; e = e->wheel_next) if (e->due_tick < best) best = e->due_tick;
+    double ms = best * (double)WHEEL_TICK_MS - now_ms();
+    return ms > 0 ? ms : 0;
+}
+
+
+// --- GAME CACHE ---
+static uint32_t hash_path(const char* s) {
+    uint32_t h = 2166136261u; // FNV-1a
+    while (*s) { h ^= (unsigned char)*s++; h *= 16777619u; }
+    return h;
+}
+
+// Returns the slot holding `path`, or -1 if absent.
+static long cache_slot(const char* path, uint32_t hash) {
+    if (!cache_cap) return -1;
+    size_t mask = cache_cap - 1;
+    for (size_t i = hash & mask; cache[i] != NULL; i = (i + 1) & mask) {
+        if (CACHE_LIVE(cache[i]) && cache[i]->hash == hash && strcmp(cache[i]->path, path) == 0) return (long)i;
+    }
+    return -1;
+}
+
+static bool cache_rehash(size_t new_cap) {
+    struct GameCache** slots = (struct GameCache**)calloc(new_cap, sizeof(*slots));
+    if (!slots) return false;
+    size_t mask = new_cap - 1;
+    for (size_t k = 0; k < cache_cap; k++) {
+        if (!CACHE_LIVE(cache[k])) continue;
+        size_t i = cache[k]->hash & mask;
+        while (slots[i]) i = (i + 1) & mask;
+        slots[i] = cache[k];
+    }
+    free(cache); cache = slots; cache_cap = new_cap; cache_used = cache_count;
+    return true;
+}
+
+struct GameCache* cache_find(const char* path) {
+    long i = cache_slot(path, hash_path(path));
+    return (i < 0) ? NULL : cache[i];
+}
+
+static void cache_set_info(struct GameCache* e, const char* title_id, const char* title_name) {
+    strncpy(e->title_id, title_id, MAX_TITLE_ID); e->title_id[MAX_TITLE_ID - 1] = '\0';
+    strncpy(e->title_name, title_name, MAX_TITLE_NAME); e->title_name[MAX_TITLE_NAME - 1] = '\0';
+}
+
+// Inserts or updates the entry for `path`.
+struct GameCache* cache_insert(const char* path, const char* title_id, const char* title_name) {
+    uint32_t hash = hash_path(path);
+    long found = cache_slot(path, hash);
+    if (found >= 0) { cache_set_info(cache[found], title_id, title_name); return cache[found]; }
+
+    // Keep load (including tombstones) under 3/4; only double if live entries need it
+    if ((cache_used + 1) * 4 > cache_cap * 3) {
+        size_t new_cap = cache_cap ? cache_cap : CACHE_MIN_SLOTS;
+        while ((cache_count + 1) * 2 > new_cap) new_cap *= 2;
+        if (!cache_rehash(new_cap)) return NULL;
+    }
+
+    struct GameCache* e = (struct GameCache*)calloc(1, sizeof(*e));
+    if (!e) return NULL;
+    strncpy(e->path, path, MAX_PATH); e->path[MAX_PATH - 1] = '\0';
+    cache_set_info(e, title_id, title_name);
+    e->hash = hash; e->root = -1;
+
+    size_t mask = cache_cap - 1, i = hash & mask;
+    while (CACHE_LIVE(cache[i])) i = (i + 1) & mask;
+    if (cache[i] == NULL) cache_used++;
+    cache[i] = e; cache_count++;
+    return e;
+}
+
+static void cache_remove_slot(size_t i) {
+    wheel_cancel(cache[i]); walk_free(cache[i]);
+    free(cache[i]); cache[i] = CACHE_TOMBSTONE; cache_count--;
+}
+
+bool cache_remove(const char* path) {
+    long i = cache_slot(path, hash_path(path));
+    if (i < 0) return false;
+    cache_remove_slot((size_t)i); return true;
+}
+
+// --- METADATA INDEX ---
+// Compact on-disk copy of the cache so a restart can skip parsing every param.json.
+// Layout: IndexHeader, then `count` records of IndexRecord + path/id/name bytes, 8-byte aligned.
+#define INDEX_MAGIC   0x58444D53 // "SMDX"
+#define INDEX_VERSION 2
+struct IndexHeader { uint32_t magic, version, count, reserved; };
+struct IndexRecord {
+    uint64_t dev, ino;
+    int64_t mtime, size, last_seen;
+    uint64_t mnt_dev, mnt_ino;
+    uint16_t path_len;
+    uint8_t id_len, name_len;
+    uint8_t install_state;
+    uint8_t drm_state;
+    uint8_t pad[2];
+};
+#define INDEX_ALIGN(n) (((n) + 7) & ~(size_t)7)
+bool index_dirty;
+
+void index_load(void) {
+    int fd = open(INDEX_FILE, O_RDONLY); if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(struct IndexHeader)) { close(fd); return; }
+    size_t len = (size_t)st.st_size;
+    const char* map = (const char*)mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0); close(fd);
+    if (map == MAP_FAILED) return;
+
+    const struct IndexHeader* hdr = (const struct IndexHeader*)map;
+    size_t off = sizeof(*hdr), loaded = 0;
+    if (hdr->magic == INDEX_MAGIC && hdr->version == INDEX_VERSION) {
+        for (uint32_t k = 0; k < hdr->count; k++) {
+            if (off + sizeof(struct IndexRecord) > len) break;
+            const struct IndexRecord* r = (const struct IndexRecord*)(map + off);
+            size_t body = (size_t)r->path_len + r->id_len + r->name_len;
+            if (r->path_len == 0 || r->path_len >= MAX_PATH || r->id_len >= MAX_TITLE_ID || off + sizeof(*r) + body > len) break;
+
+            char path[MAX_PATH], id[MAX_TITLE_ID], name[MAX_TITLE_NAME];
+            const char* p = map + off + sizeof(*r);
+            memcpy(path, p, r->path_len); path[r->path_len] = '\0'; p += r->path_len;
+            memcpy(id, p, r->id_len); id[r->id_len] = '\0'; p += r->id_len;
+            memcpy(name, p, r->name_len); name[r->name_len] = '\0';
+
+            struct GameCache* e = cache_insert(path, id, name);
+            if (e) {
+                e->dev = r->dev; e->ino = r->ino; e->mtime = r->mtime; e->size = r->size;
+                e->last_seen = (time_t)r->last_seen; e->install_state = r->install_state; e->drm_state = r->drm_state;
+                e->mnt_dev = r->mnt_dev; e->mnt_ino = r->mnt_ino;
+                loaded++;
+            }
+            off += INDEX_ALIGN(sizeof(*r) + body);
+        }
+    }
+    munmap((void*)map, len);
+    log_debug("[INDEX] Loaded %zu titles", loaded);
+}
+
+void index_save(void) {
+    if (!index_dirty) return;
+    char tmp[MAX_PATH]; snprintf(tmp, sizeof(tmp), "%s.tmp", INDEX_FILE);
+    FILE* f = fopen(tmp, "wb"); if (!f) return;
+
+    time_t now = time(NULL);
+    struct IndexHeader hdr = { INDEX_MAGIC, INDEX_VERSION, 0, 0 };
+    fwrite(&hdr, sizeof(hdr), 1, f);
+    static const char zeros[8];
+    for (size_t k = 0; k < cache_cap; k++) {
+        const struct GameCache* e = cache[k];
+        if (!CACHE_LIVE(e) || difftime(now, e->last_seen) > INDEX_STALE_SECS) continue;
+        struct IndexRecord r; memset(&r, 0, sizeof(r));
+        r.dev = e->dev; r.ino = e->ino; r.mtime = e->mtime; r.size = e->size;
+        r.last_seen = e->last_seen; r.install_state = e->install_state; r.drm_state = e->drm_state;
+        r.mnt_dev = e->mnt_dev; r.mnt_ino = e->mnt_ino;
+        r.path_len = (uint16_t)strlen(e->path); r.id_len = (uint8_t)strlen(e->title_id); r.name_len = (uint8_t)strlen(e->title_name);
+        size_t body = sizeof(r) + r.path_len + r.id_len + r.name_len;
+        fwrite(&r, sizeof(r), 1, f);
+        fwrite(e->path, 1, r.path_len, f); fwrite(e->title_id, 1, r.id_len, f); fwrite(e->title_name, 1, r.name_len, f);
+        fwrite(zeros, 1, INDEX_ALIGN(body) - body, f);
+        hdr.count++;
+    }
+    fseek(f, 0, SEEK_SET); fwrite(&hdr, sizeof(hdr), 1, f);
+    bool ok = (fflush(f) == 0) && (fsync(fileno(f)) == 0) && !ferror(f);
+    fclose(f);
+    if (ok && rename(tmp, INDEX_FILE) == 0) index_dirty = false;
+    else remove(tmp);
+}
+
+// --- NEGATIVE CACHE ---
+// Remembers directories that are not games, keyed on (st_dev, st_ino) and
+// validated by mtime, so idle scans cost one stat() per non-game folder.
+enum { SYS_NONE, SYS_DIR, SYS_PARAM };
+enum { NEG_EMPTY, NEG_LIVE, NEG_TOMB };
+struct NegCache {
+    dev_t dev; ino_t ino;
+    time_t mtime;       // Directory mtime when the probe failed
+    time_t sys_mtime;   // mtime of sce_sys (or its param.json) if present
+    uint32_t gen;       // Last scan generation that saw this entry
+    uint8_t sys_kind;
+    uint8_t state;
+};
+struct NegCache* neg_cache;
+size_t neg_cap, neg_count, neg_used;
+uint32_t neg_gen;
+
+static size_t neg_hash(dev_t dev, ino_t ino) {
+    uint64_t h = ((uint64_t)dev * 0x9E3779B97F4A7C15ull) ^ (uint64_t)ino;
+    h ^= h >> 33; h *= 0xff51afd7ed558ccdull; h ^= h >> 33;
+    return (size_t)h;
+}
+
+static struct NegCache* neg_find(dev_t dev, ino_t ino) {
+    if (!neg_cap) return NULL;
+    size_t mask = neg_cap - 1;
+    for (size_t i = neg_hash(dev, ino) & mask; neg_cache[i].state != NEG_EMPTY; i = (i + 1) & mask) {
+        if (neg_cache[i].state == NEG_LIVE && neg_cache[i].dev == dev && neg_cache[i].ino == ino) return &neg_cache[i];
+    }
+    return NULL;
+}
+
+static void neg_drop(struct NegCache* n) { n->state = NEG_TOMB; neg_count--; }
+
+static bool neg_rehash(size_t new_cap) {
+    struct NegCache* slots = (struct NegCache*)calloc(new_cap, sizeof(*slots));
+    if (!slots) return false;
+    size_t mask = new_cap - 1;
+    for (size_t k = 0; k < neg_cap; k++) {
+        if (neg_cache[k].state != NEG_LIVE) continue;
+        size_t i = neg_hash(neg_cache[k].dev, neg_cache[k].ino) & mask;
+        while (slots[i].state != NEG_EMPTY) i = (i + 1) & mask;
+        slots[i] = neg_cache[k];
+    }
+    free(neg_cache); neg_cache = slots; neg_cap = new_cap; neg_used = neg_count;
+    return true;
+}
+
+// Which file inside the candidate decides whether it becomes a game later on
+static uint8_t neg_sys_probe(const char* path, time_t* out_mtime) {
+    char sys_path[MAX_PATH]; struct stat st;
+    snprintf(sys_path, sizeof(sys_path), "%s/sce_sys/param.json", path);
+    if (stat(sys_path, &st) == 0) { *out_mtime = st.st_mtime; return SYS_PARAM; }
+    snprintf(sys_path, sizeof(sys_path), "%s/sce_sys", path);
+    if (stat(sys_path, &st) == 0) { *out_mtime = st.st_mtime; return SYS_DIR; }
+    *out_mtime = 0; return SYS_NONE;
+}
+
+// True if `st` is a directory already known not to be a game.
+bool neg_cache_hit(const char* path, const struct stat* st) {
+    struct NegCache* n = neg_find(st->st_dev, st->st_ino);
+    if (!n) return false;
+    if (n->mtime != st->st_mtime) { neg_drop(n); return false; }
+    if (n->sys_kind != SYS_NONE) {
+        // sce_sys already existed: param.json may still be arriving inside it
+        time_t sys_mtime;
+        if (neg_sys_probe(path, &sys_mtime) != n->sys_kind || sys_mtime != n->sys_mtime) { neg_drop(n); return false; }
+    }
+    n->gen = neg_gen;
+    return true;
+}
+
+void neg_cache_add(const char* path, const struct stat* st) {
+    time_t now = time(NULL), sys_mtime;
+    if (difftime(now, st->st_mtime) < NEG_SETTLE_SECS) return; // Still changing, probe again next cycle
+    uint8_t sys_kind = neg_sys_probe(path, &sys_mtime);
+    if (sys_kind != SYS_NONE && difftime(now, sys_mtime) < NEG_SETTLE_SECS) return; // param.json still being written
+    struct NegCache* n = neg_find(st->st_dev, st->st_ino);
+    if (!n) {
+        if ((neg_used + 1) * 4 > neg_cap * 3) {
+            size_t new_cap = neg_cap ? neg_cap : CACHE_MIN_SLOTS;
+            while ((neg_count + 1) * 2 > new_cap) new_cap *= 2;
+            if (!neg_rehash(new_cap)) return;
+        }
+        size_t mask = neg_cap - 1, i = neg_hash(st->st_dev, st->st_ino) & mask;
+        while (neg_cache[i].state == NEG_LIVE) i = (i + 1) & mask;
+        if (neg_cache[i].state == NEG_EMPTY) neg_used++;
+        n = &neg_cache[i]; n->state = NEG_LIVE; neg_count++;
+        n->dev = st->st_dev; n->ino = st->st_ino;
+    }
+    n->mtime = st->st_mtime;
+    n->sys_kind = sys_kind; n->sys_mtime = sys_mtime;
+    n->gen = neg_gen;
+}
+
+// Forget directories that were not seen by the last full scan (deleted, unplugged)
+void neg_cache_prune(void) {
+    for (size_t k = 0; k < neg_cap; k++) {
+        if (neg_cache[k].state == NEG_LIVE && neg_cache[k].gen != neg_gen) neg_drop(&neg_cache[k]);
+    }
+}
+
+// --- LOGGING ---
+// Callers format into a lock-free ring (bounded MPMC sequence slots) and return; a
+// background thread stamps the lines and appends them to one persistent fd with a single
+// write() per batch. Before log_start() and if the thread cannot be started, lines are
+// written synchronously. The ring is flushed on shutdown and on fatal signals. A caller
+// that finds it full waits up to LOG_FULL_WAIT_MS for the thread to catch up, then drops
+// the line (counted) rather than stalling a worker indefinitely.
+#define LOG_SLOTS   512         // Power of two
+#define LOG_FULL_WAIT_MS 50
+#define LOG_LINE    1024
+struct LogSlot { atomic_size_t seq; time_t when; size_t len; char text[LOG_LINE]; };
+struct LogSlot log_ring[LOG_SLOTS];
+atomic_size_t log_head, log_tail;
+atomic_uint log_dropped;
+atomic_bool log_sleeping;
+atomic_bool log_busy, log_dead;   // Log thread mid-batch / crash handler took over
+bool log_async;
+int log_fd = -1;
+pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t log_wake = PTHREAD_COND_INITIALIZER;
+
+static void log_open(void) {
+    if (log_fd >= 0) return;
+    mkdir(LOG_DIR, 0777);
+    log_fd = open(LOG_FILE, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+}
+
+// "[HH:MM:SS] " for `when`; localtime is only consulted when the second changes
+static size_t log_stamp(time_t when, char* out) {
+    static time_t last = -1; static char prefix[16]; static size_t plen;
+    if (when != last) {
+        struct tm tm; localtime_r(&when, &tm); last = when;
+        plen = strftime(prefix, sizeof(prefix), "[%H:%M:%S] ", &tm);
+    }
+    memcpy(out, prefix, plen);
+    return plen;
+}
+
+// Writes the ready lines from the ring to the log file and stdout. Log thread, or the
+// only thread left in a flush. Returns the number of lines written.
+static size_t log_drain(void) {
+    static char file_buf[LOG_SLOTS / 4 * (LOG_LINE + 16)], out_buf[LOG_SLOTS / 4 * (LOG_LINE + 1)];
+    size_t lines = 0;
+    for (;;) {
+        size_t fo = 0, oo = 0, batch = 0, tail = atomic_load_explicit(&log_tail, memory_order_relaxed);
+        unsigned dropped = atomic_exchange(&log_dropped, 0);
+        if (dropped) fo += (size_t)snprintf(file_buf, 64, "[LOG] %u line(s) dropped, ring full\n", dropped);
+        for (; batch < LOG_SLOTS / 4; batch++, tail++) {
+            struct LogSlot* sl = &log_ring[tail & (LOG_SLOTS - 1)];
+            if (atomic_load_explicit(&sl->seq, memory_order_acquire) != tail + 1) break;
+            fo += log_stamp(sl->when, file_buf + fo);
+            memcpy(file_buf + fo, sl->text, sl->len); fo += sl->len; file_buf[fo++] = '\n';
+            memcpy(out_buf + oo, sl->text, sl->len); oo += sl->len; out_buf[oo++] = '\n';
+            atomic_store_explicit(&sl->seq, tail + LOG_SLOTS, memory_order_release);
+        }
+        if (fo) { log_open(); if (log_fd >= 0) (void)!write(log_fd, file_buf, fo); }
+        if (oo) (void)!write(STDOUT_FILENO, out_buf, oo);
+        atomic_store_explicit(&log_tail, tail, memory_order_release); // Only once written: log_flush() waits on it
+        lines += batch;
+        if (batch < LOG_SLOTS / 4) return lines;
+    }
+}
+
+static bool log_ring_ready(void) {
+    size_t tail = atomic_load_explicit(&log_tail, memory_order_relaxed);
+    return atomic_load_explicit(&log_ring[tail & (LOG_SLOTS - 1)].seq, memory_order_acquire) == tail + 1;
+}
+
+static void* log_thread(void* arg) {
+    (void)arg;
+    for (;;) {
+        atomic_store(&log_busy, true);
+        if (atomic_load(&log_dead)) { atomic_store(&log_busy, false); return NULL; }
+        size_t n = log_drain();
+        atomic_store(&log_busy, false);
+        if (n) continue;
+        pthread_mutex_lock(&log_lock);
+        atomic_store(&log_sleeping, true);
+        if (!log_ring_ready() && !atomic_load(&log_dropped)) pthread_cond_wait(&log_wake, &log_lock);
+        atomic_store(&log_sleeping, false);
+        pthread_mutex_unlock(&log_lock);
+    }
+    return NULL;
+}
+
+static void log_ring_init(void) {
+    static bool done;
+    if (done) return;
+    for (size_t k = 0; k < LOG_SLOTS; k++) atomic_init(&log_ring[k].seq, k);
+    done = true;
+}
+
+static void log_kick(void) {
+    atomic_thread_fence(memory_order_seq_cst); // Publish before checking, pairs with log_thread()
+    if (atomic_load(&log_sleeping)) { pthread_mutex_lock(&log_lock); pthread_cond_signal(&log_wake); pthread_mutex_unlock(&log_lock); }
+}
+
+static bool log_push(const char* fmt, va_list args) {
+    size_t pos = atomic_load_explicit(&log_head, memory_order_relaxed);
+    struct LogSlot* sl; int waited = 0;
+    for (;;) {
+        sl = &log_ring[pos & (LOG_SLOTS - 1)];
+        size_t seq = atomic_load_explicit(&sl->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0 && atomic_compare_exchange_weak_explicit(&log_head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) break;
+        if (diff < 0) { // Full
+            if (!log_async || waited++ >= LOG_FULL_WAIT_MS * 10) return false;
+            log_kick(); plat_sleep_us(100);
+        }
+        if (diff != 0) pos = atomic_load_explicit(&log_head, memory_order_relaxed);
+    }
+    int n = vsnprintf(sl->text, LOG_LINE, fmt, args);
+    sl->len = n < 0 ? 0 : (n >= LOG_LINE ? LOG_LINE - 1 : (size_t)n);
+    sl->when = time(NULL);
+    atomic_store_explicit(&sl->seq, pos + 1, memory_order_release);
+    log_kick();
+    return true;
+}
+
+void log_debug(const char* fmt, ...) {
+    va_list args; va_start(args, fmt);
+    if (!log_async) {
+        // Synchronous: before log_start() or without a log thread
+        pthread_mutex_lock(&log_lock);
+        log_ring_init();
+        if (log_push(fmt, args)) log_drain();
+        pthread_mutex_unlock(&log_lock);
+    } else if (!log_push(fmt, args)) atomic_fetch_add(&log_dropped, 1);
+    va_end(args);
+}
+
+// Waits (bounded) for the log thread to write everything queued so far, then syncs the file.
+void log_flush(void) {
+    if (log_async) {
+        for (int k = 0; k < 1000 && atomic_load(&log_tail) != atomic_load(&log_head); k++) plat_sleep_us(1000);
+    }
+    if (log_fd >= 0) fsync(log_fd);
+}
+
+// Fatal signals: write out whatever is ready (write() only), then die with the default action.
+static void log_crash(int sig) {
+    log_async = false;
+    atomic_store(&log_dead, true);
+    // Let a batch in progress finish; give up if the log thread is the one that crashed
+    struct timespec ms = { 0, 1000000 };
+    for (int k = 0; k < 100 && atomic_load(&log_busy); k++) nanosleep(&ms, NULL);
+    size_t tail = atomic_load(&log_tail);
+    for (size_t k = 0; k < LOG_SLOTS; k++, tail++) {
+        struct LogSlot* sl = &log_ring[tail & (LOG_SLOTS - 1)];
+        if (atomic_load(&sl->seq) != tail + 1) break;
+        if (log_fd >= 0) { (void)!write(log_fd, sl->text, sl->len); (void)!write(log_fd, "\n", 1); }
+    }
+    if (log_fd >= 0) fsync(log_fd);
+    signal(sig, SIG_DFL); raise(sig);
+}
+
+void log_start(void) {
+    log_ring_init();
+    log_open();
+    const int fatal[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+    for (size_t k = 0; k < sizeof(fatal) / sizeof(fatal[0]); k++) signal(fatal[k], log_crash);
+    pthread_t t;
+    if (pthread_create(&t, NULL, log_thread, NULL) == 0) { pthread_detach(t); log_async = true; }
+}
+
+// --- TRACING ---
+// Built with TRACE (make TRACE=1): TRACE_SCOPE(name, arg) records a span from that line to
+// the end of the enclosing block into a per-thread buffer, timestamped on the monotonic
+// clock. trace_export() writes every buffer as Chrome trace-event JSON (chrome://tracing,
+// Perfetto). Release builds compile all of it out.
+#ifdef TRACE
+#define TRACE_FILE      "/data/shadowmount/trace.json"
+#define TRACE_EVENTS    8192    // Per thread; the oldest spans are overwritten
+struct TraceEvent { const char* name; char arg[48]; double start_ms, dur_ms; };
+struct TraceBuf { int tid; atomic_size_t count; struct TraceEvent ev[TRACE_EVENTS]; struct TraceBuf* next; };
+struct TraceScope { const char* name; const char* arg; double start_ms; };
+struct TraceBuf* trace_bufs;
+pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+__thread struct TraceBuf* trace_self;
+
+void trace_scope_end(struct TraceScope* sc) {
+    if (!trace_self) {
+        struct TraceBuf* b = (struct TraceBuf*)calloc(1, sizeof(*b)); if (!b) return;
+        pthread_mutex_lock(&trace_lock);
+        b->tid = trace_bufs ? trace_bufs->tid + 1 : 1; b->next = trace_bufs; trace_bufs = b;
+        pthread_mutex_unlock(&trace_lock);
+        trace_self = b;
+    }
+    size_t n = atomic_load_explicit(&trace_self->count, memory_order_relaxed);
+    struct TraceEvent* e = &trace_self->ev[n % TRACE_EVENTS];
+    e->name = sc->name; e->start_ms = sc->start_ms; e->dur_ms = now_ms() - sc->start_ms;
+    snprintf(e->arg, sizeof(e->arg), "%s", sc->arg ? sc->arg : "");
+    atomic_store_explicit(&trace_self->count, n + 1, memory_order_release);
+}
+
+#define TRACE_CAT_(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT_(a, b)
+#define TRACE_SCOPE(name, arg) struct TraceScope TRACE_CAT(trace_scope_, __LINE__) __attribute__((cleanup(trace_scope_end))) = { name, arg, now_ms() }
+
+static void trace_json_str(FILE* f, const char* s) {
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', f);
+        if ((unsigned char)*s >= 0x20) fputc(*s, f);
+    }
+}
+
+// Writes all recorded spans to TRACE_FILE. Best taken while the workers are idle.
+void trace_export(void) {
+    char tmp[MAX_PATH]; snprintf(tmp, sizeof(tmp), "%s.tmp", TRACE_FILE);
+    FILE* f = fopen(tmp, "w"); if (!f) return;
+    fputs("{\"traceEvents\":[", f);
+    bool first = true; size_t total = 0;
+    pthread_mutex_lock(&trace_lock);
+    for (struct TraceBuf* b = trace_bufs; b; b = b->next) {
+        size_t n = atomic_load_explicit(&b->count, memory_order_acquire);
+        for (size_t k = n > TRACE_EVENTS ? n - TRACE_EVENTS : 0; k < n; k++, total++) {
+            const struct TraceEvent* e = &b->ev[k % TRACE_EVENTS];
+            fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.0f,\"dur\":%.0f,\"args\":{\"arg\":\"",
+                    first ? "" : ",\n", e->name, b->tid, e->start_ms * 1000.0, e->dur_ms * 1000.0);
+            trace_json_str(f, e->arg); fputs("\"}}", f);
+            first = false;
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+    fputs("]}\n", f);
+    if (fclose(f) == 0 && rename(tmp, TRACE_FILE) == 0) log_debug("[TRACE] %zu span(s) -> %s", total, TRACE_FILE);
+}
+#else
+#define TRACE_SCOPE(name, arg) ((void)0)
+#define trace_export() ((void)0)
+#endif
+
+// --- METRICS ---
+// Process-wide counters and latency histograms, safe to bump from any thread (relaxed
+// atomics). Histograms are HDR-style: log-linear buckets with 8 sub-buckets per power of
+// two, so every recorded value keeps ~12% precision from 1 us up to hours. Exposition
+// (Prometheus text format, METRICS_FILE and the `metrics` control command) is further down.
+enum {
+    C_SCAN_CYCLES, C_ROOTS_LISTED, C_DIR_ENTRIES, C_STAT_CALLS, C_PARAM_PARSES, C_PARAM_REUSED, C_DRM_REWRITES,
+    C_COPY_FILES, C_COPY_BYTES, C_COPY_SKIPPED_FILES, C_COPY_SKIPPED_BYTES, C_COPY_ERRORS,
+    C_MOUNTS, C_MOUNT_FAILURES, C_SYSEX_REMOUNTS, C_SYSEX_REDONE, C_REGISTRATIONS, C_REGISTER_FAILURES,
+    C_RETRIES, C_DEVICES_ADDED, C_DEVICES_LOST, C_MOUNTS_REAPED, C_CTL_COMMANDS, C_COUNT
+};
+const char* COUNTER_INFO[C_COUNT][2] = {
+    { "scan_cycles_total", "Scan cycles run" },
+    { "roots_listed_total", "Scan root listings read" },
+    { "dir_entries_total", "Directory entries read while listing roots" },
+    { "stat_calls_total", "stat() calls on the scan path (roots, candidates, stability walks)" },
+    { "param_parses_total", "param.json files read and parsed" },
+    { "param_reused_total", "Candidates whose param.json fingerprint matched the cache" },
+    { "drm_rewrites_total", "param.json applicationDrmType rewrites" },
+    { "copy_files_total", "Asset files copied" },
+    { "copy_bytes_total", "Asset bytes copied" },
+    { "copy_skipped_files_total", "Asset files left alone because they were unchanged" },
+    { "copy_skipped_bytes_total", "Asset bytes not copied because they were unchanged" },
+    { "copy_errors_total", "Asset files that failed to copy" },
+    { "mounts_total", "nullfs mounts attempted" },
+    { "mount_failures_total", "nullfs mounts that failed" },
+    { "system_ex_remounts_total", "system_ex remounts" },
+    { "system_ex_redone_total", "system_ex remounts redone after a permission error" },
+    { "registrations_total", "AppInstUtil registrations attempted" },
+    { "register_failures_total", "AppInstUtil registrations that failed" },
+    { "retries_total", "Install retries scheduled" },
+    { "devices_added_total", "Storage devices discovered" },
+    { "devices_lost_total", "Storage devices removed" },
+    { "mounts_reaped_total", "Title mounts force-unmounted after a device was removed" },
+    { "control_commands_total", "Control socket commands served" },
+};
+atomic_uint_fast64_t counters[C_COUNT];
+
+#define HIST_SUB_BITS   3
+#define HIST_BUCKETS    320     // Covers values up to 2^40
+enum { H_SCAN, H_PARSE, H_COPY_RATE, H_MOUNT, H_REGISTER, H_DISCOVER, H_SETTLE, H_COPY, H_COUNT };
+struct Histogram {
+    const char* name; const char* help;
+    double scale;               // Recorded unit -> exposed base unit
+    atomic_uint_fast32_t b[HIST_BUCKETS];
+    atomic_uint_fast64_t count, sum, max;
+};
+struct Histogram hists[H_COUNT] = {
+    [H_SCAN] = { .name = "scan_cycle_seconds", .help = "Duration of a scan cycle", .scale = 1e-6 },
+    [H_PARSE] = { .name = "param_parse_seconds", .help = "Reading and parsing one param.json", .scale = 1e-6 },
+    [H_COPY_RATE] = { .name = "copy_rate_bytes_per_second", .help = "Asset copy throughput per title", .scale = 1024 },
+    [H_MOUNT] = { .name = "mount_seconds", .help = "Mounting one title (nullfs, including a system_ex remount)", .scale = 1e-6 },
+    [H_REGISTER] = { .name = "register_seconds", .help = "Registering one title, including the wait for appmeta", .scale = 1e-6 },
+    [H_DISCOVER] = { .name = "discover_seconds", .help = "From a root changing to a new title being found in it", .scale = 1e-6 },
+    [H_SETTLE] = { .name = "settle_seconds", .help = "From discovery until a title counts as fully copied", .scale = 1e-6 },
+    [H_COPY] = { .name = "copy_seconds", .help = "Copying one title's assets, including the wait in the copy queue", .scale = 1e-6 },
+};
+
+static inline void metric_add(int c, uint64_t n) { atomic_fetch_add_explicit(&counters[c], n, memory_order_relaxed); }
+static inline void metric_inc(int c) { metric_add(c, 1); }
+static inline uint64_t metric_get(int c) { return atomic_load_explicit(&counters[c], memory_order_relaxed); }
+
+static int hist_index(uint64_t v) {
+    if (v < (1u << HIST_SUB_BITS)) return (int)v;
+    int msb = 63 - __builtin_clzll(v), shift = msb - HIST_SUB_BITS;
+    int i = ((shift + 1) << HIST_SUB_BITS) + (int)((v >> shift) & ((1u << HIST_SUB_BITS) - 1));
+    return i < HIST_BUCKETS ? i : HIST_BUCKETS - 1;
+}
+
+// Largest value that lands in bucket `i`
+static uint64_t hist_upper(int i) {
+    if (i + 1 < (1 << HIST_SUB_BITS)) return (uint64_t)i;
+    int next = i + 1, shift = (next >> HIST_SUB_BITS) - 1;
+    return ((uint64_t)((1u << HIST_SUB_BITS) + (next & ((1u << HIST_SUB_BITS) - 1))) << shift) - 1;
+}
+
+void hist_record(int h, uint64_t v) {
+    struct Histogram* hg = &hists[h];
+    atomic_fetch_add_explicit(&hg->b[hist_index(v)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hg->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hg->sum, v, memory_order_relaxed);
+    uint_fast64_t m = atomic_load_explicit(&hg->max, memory_order_relaxed);
+    while (v > m && !atomic_compare_exchange_weak_explicit(&hg->max, &m, v, memory_order_relaxed, memory_order_relaxed)) {}
+}
+
+// Records a duration that started at `start_ms` (now_ms() clock) in microseconds
+void hist_since(int h, double start_ms) { double us = (now_ms() - start_ms) * 1000.0; hist_record(h, us > 0 ? (uint64_t)us : 0); }
+
+// Value at quantile `q` (upper bucket bound, recorded units)
+uint64_t hist_quantile(const struct Histogram* hg, double q) {
+    uint64_t total = atomic_load_explicit(&hg->count, memory_order_relaxed), seen = 0;
+    if (!total) return 0;
+    uint64_t want = (uint64_t)(q * total + 0.5); if (want < 1) want = 1;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += atomic_load_explicit(&hg->b[i], memory_order_relaxed);
+        if (seen >= want) { uint64_t u = hist_upper(i), m = atomic_load_explicit(&hg->max, memory_order_relaxed); return u < m ? u : m; }
+    }
+    return atomic_load_explicit(&hg->max, memory_order_relaxed);
+}
+
+// --- NOTIFICATIONS ---
+void notify_system(const char* fmt, ...) {
+    char msg[3075];
+    va_list args; va_start(args, fmt); vsnprintf(msg, sizeof(msg), fmt, args); va_end(args);
+    plat_notify(msg);
+    log_debug("NOTIFY: %s", msg);
+}
+
+void trigger_rich_toast(const char* title_id, const char* game_name, const char* msg) {
+    FILE* f = fopen(TOAST_FILE, "w");
+    if (f) {
+        fprintf(f, "%s|%s|%s", title_id, game_name, msg);
+        fflush(f); fclose(f);
+    }
+}
+
+// --- FILESYSTEM ---
+// snprintf() for paths. Returns false if the result did not fit in `size` bytes.
+static bool path_fmt(char* out, size_t size, const char* fmt, ...) {
+    va_list args; va_start(args, fmt);
+    int n = vsnprintf(out, size, fmt, args); va_end(args);
+    return n >= 0 && (size_t)n < size;
+}
+
+bool is_installed(const char* title_id) { char path[MAX_PATH]; snprintf(path, sizeof(path), "/user/app/%s", title_id); struct stat st; return (stat(path, &st) == 0); }
+
+// --- WATCHER ---
+// Each scan root is watched for directory changes (kqueue EVFILT_VNODE on the console,
+// inotify on a Linux host) so the daemon only relists roots that actually changed.
+// A root that does not exist yet is watched through its nearest existing ancestor until
+// it appears. Mount table changes are watched too (EVFILT_FS / mountinfo POLLPRI), as is
+// LOG_DIR for the STOP file, so with every root watched the loop sleeps until something
+// happens. Roots that cannot be watched are polled every cycle.
+// A root's listing is only reread when its directory fingerprint moves.
+// kqueue needs an open fd per watched directory. Where there is no O_EVTONLY (FreeBSD, so
+// the console) those fds keep a drive busy just like the title mounts on it do, and a
+// non-forced eject fails with EBUSY. The system has to force the unmount; the hot-unplug
+// reaper then lets go of the drive's watches and titles.
+struct RootPrint { dev_t dev; ino_t ino; time_t mtime; nlink_t nlink; };
+struct ScanRoot {
+    char path[MAX_PATH];
+    bool active;            // Internal root, or subfolder of a mounted device
+    int wd;                 // kqueue: open fd, inotify: watch descriptor, -1 = polled
+    dev_t dev; ino_t ino;   // Identity of the watched directory (an ancestor while missing)
+    struct RootPrint cur;   // Fingerprint from the last stat(), zero while missing
+    struct RootPrint listed;// Fingerprint when the listing was last read
+    bool dirty;             // Needs relisting this cycle
+    double dirty_at;        // When the change was noticed (ms, monotonic)
+};
+struct ScanRoot roots[MAX_ROOTS];
+int watch_fd = -1;
+int wake_pipe[2] = { -1, -1 }; // Install workers write a byte here when a job finishes
+int ctl_fd = -1;               // Control socket, see CONTROL
+bool ctl_ready;                // ... has a connection waiting
+int dir_wd = -1;               // LOG_DIR watch, for the STOP file
+bool mounts_watched;           // Mount table changes wake watcher_wait()
+#ifdef __linux__
+int mountinfo_fd = -1;
+#endif
+#define WATCH_UDATA_DIR (-2)   // kqueue udata of the LOG_DIR watch
+
+double now_ms(void) {
+    struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void root_mark_dirty(int i) {
+    if (!roots[i].dirty) { roots[i].dirty = true; roots[i].dirty_at = now_ms(); }
+}
+
+static void watch_drop(int i) {
+    if (roots[i].wd < 0) return;
+#ifdef __linux__
+    // inotify hands out one wd per inode; keep it while another root shares it
+    bool shared = false;
+    for (int k = 0; k < MAX_ROOTS; k++) if (k != i && roots[k].active && roots[k].wd == roots[i].wd) shared = true;
+    if (!shared) inotify_rm_watch(watch_fd, roots[i].wd);
+#else
+    close(roots[i].wd); // Closing the fd removes its kevent
+#endif
+    roots[i].wd = -1;
+}
+
+// Watches directory `path` on behalf of root `i` (udata `i`, or WATCH_UDATA_DIR). Returns the wd.
+static int watch_dir(const char* path, int i) {
+#ifdef __linux__
+    (void)i;
+    return inotify_add_watch(watch_fd, path, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB |
+                                             IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+#else
+#ifdef O_EVTONLY
+    int wd = open(path, O_EVTONLY | O_DIRECTORY); // Does not hold off an unmount
+#else
+    int wd = open(path, O_RDONLY | O_DIRECTORY);
+#endif
+    if (wd < 0) return -1;
+    struct kevent kev;
+    EV_SET(&kev, wd, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE | NOTE_EXTEND | NOTE_ATTRIB | NOTE_LINK | NOTE_DELETE | NOTE_RENAME | NOTE_REVOKE, 0, (void*)(intptr_t)i);
+    if (kevent(watch_fd, &kev, 1, NULL, 0, NULL) < 0) { close(wd); return -1; }
+    return wd;
+#endif
+}
+
+static bool watch_add(int i, const char* path, const struct stat* st) {
+    if (watch_fd < 0) return false;
+    int wd = watch_dir(path, i);
+    if (wd < 0) return false;
+    roots[i].wd = wd; roots[i].dev = st->st_dev; roots[i].ino = st->st_ino;
+    return true;
+}
+
+// Missing root: watch the closest ancestor that exists, so its creation wakes us. Moves
+// down the tree as the intermediate folders appear.
+static void watch_ancestor(int i) {
+    char path[MAX_PATH]; strcpy(path, roots[i].path);
+    struct stat st;
+    for (char* slash; (slash = strrchr(path, '/')) != NULL; ) {
+        if (slash == path) slash[1] = '\0'; else *slash = '\0';
+        if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+            if (roots[i].wd >= 0 && roots[i].dev == st.st_dev && roots[i].ino == st.st_ino) return;
+            watch_drop(i); watch_add(i, path, &st);
+            return;
+        }
+        if (slash == path) return;
+    }
+}
+
+void watcher_init(void) {
+#ifdef __linux__
+    watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    mountinfo_fd = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    mounts_watched = mountinfo_fd >= 0;
+#else
+    watch_fd = kqueue();
+    if (watch_fd >= 0) {
+        struct kevent kev;
+        EV_SET(&kev, 0, EVFILT_FS, EV_ADD | EV_CLEAR, VQ_MOUNT | VQ_UNMOUNT, 0, NULL);
+        mounts_watched = kevent(watch_fd, &kev, 1, NULL, 0, NULL) == 0;
+    }
+#endif
+    if (watch_fd < 0) log_debug("[WATCH] Backend unavailable (%s), polling all roots", strerror(errno));
+    else dir_wd = watch_dir(LOG_DIR, WATCH_UDATA_DIR);
+    if (!mounts_watched) log_debug("[WATCH] Mount table changes not observable, polling for devices");
+    for (int i = 0; i < MAX_ROOTS; i++) roots[i].wd = -1;
+    for (int i = 0; INTERNAL_ROOTS[i] != NULL; i++) {
+        strncpy(roots[i].path, INTERNAL_ROOTS[i], MAX_PATH - 1);
+        roots[i].active = true;
+    }
+}
+
+static bool root_print_eq(const struct RootPrint* a, const struct RootPrint* b) {
+    return a->dev == b->dev && a->ino == b->ino && a->mtime == b->mtime && a->nlink == b->nlink;
+}
+
+// One stat() per root before a scan. Re-arms watches on roots whose directory was replaced
+// (e.g. a drive mounted over an empty mount point, or a missing root that appeared) and marks
+// a root dirty when its fingerprint moved, which also covers roots that can only be polled.
+void watcher_sync(void) {
+    for (int i = 0; i < MAX_ROOTS; i++) {
+        if (!roots[i].active) continue;
+        struct stat st; metric_inc(C_STAT_CALLS);
+        if (stat(roots[i].path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+            if (roots[i].cur.ino) { watch_drop(i); root_mark_dirty(i); }
+            memset(&roots[i].cur, 0, sizeof(roots[i].cur));
+            memset(&roots[i].listed, 0, sizeof(roots[i].listed));
+            watch_ancestor(i);
+            continue;
+        }
+        if (roots[i].wd >= 0 && (roots[i].dev != st.st_dev || roots[i].ino != st.st_ino)) { watch_drop(i); root_mark_dirty(i); }
+        if (roots[i].wd < 0) watch_add(i, roots[i].path, &st); // Watch before listing so nothing created in between is missed
+
+        struct RootPrint fp = { st.st_dev, st.st_ino, st.st_mtime, st.st_nlink };
+        roots[i].cur = fp;
+        if (!root_print_eq(&fp, &roots[i].listed)) root_mark_dirty(i);
+    }
+}
+
+// Records the fingerprint the listing was read at. A root modified within the mtime
+// granularity is left unmatched so it gets listed again next cycle.
+static void root_listed(int i) {
+    roots[i].dirty = false;
+    if (difftime(time(NULL), roots[i].cur.mtime) < NEG_SETTLE_SECS) memset(&roots[i].listed, 0, sizeof(roots[i].listed));
+    else roots[i].listed = roots[i].cur;
+}
+
+// How long the loop may sleep: forever (-1) when every change would wake it, otherwise
+// until the next poll, the next timer, a pending folder recheck, or the relist of a root
+// modified too recently.
+int watcher_idle_timeout(double due_ms) {
+    bool all_watched = watch_fd >= 0 && mounts_watched;
+    bool recent = false;
+    for (int i = 0; i < MAX_ROOTS; i++) {
+        if (!roots[i].active) continue;
+        if (roots[i].wd < 0) all_watched = false;
+        if (roots[i].cur.ino && !roots[i].listed.ino) recent = true;
+    }
+    double t = all_watched ? -1 : SCAN_INTERVAL_US / 1000;
+    if (recent && (t < 0 || t > NEG_SETTLE_SECS * 1000)) t = NEG_SETTLE_SECS * 1000;
+    if (due_ms >= 0 && (t < 0 || due_ms < t)) t = due_ms + 1;
+    double pending_ms = pending_next_due_ms();
+    if (pending_ms >= 0 && (t < 0 || pending_ms < t)) t = pending_ms + 1;
+    return (int)t;
+}
+
+static void roots_of_watch_dirty(int wd, int* changed, bool drop) {
+    for (int i = 0; i < MAX_ROOTS; i++) {
+        if (!roots[i].active || roots[i].wd != wd) continue;
+        if (!roots[i].dirty) (*changed)++;
+        root_mark_dirty(i);
+        if (drop) roots[i].wd = -1; // The kernel already removed the watch
+    }
+}
+
+// Sleeps until a watched root, the mount table or LOG_DIR changes, an install job finishes,
+// a control client connects, or `timeout_ms` elapses (-1: no timeout). Returns the number
+// of roots that became dirty.
+int watcher_wait(int timeout_ms) {
+    struct pollfd pfd[4] = { { watch_fd, POLLIN, 0 }, { wake_pipe[0], POLLIN, 0 }, { ctl_fd, POLLIN, 0 }, { -1, 0, 0 } };
+#ifdef __linux__
+    pfd[3].fd = mountinfo_fd; pfd[3].events = POLLPRI;
+#endif
+    bool any = false;
+    for (int k = 0; k < 4; k++) any |= pfd[k].fd >= 0; // Negative fds are ignored by poll()
+    if (!any) { plat_sleep_us((unsigned)(timeout_ms < 0 ? SCAN_INTERVAL_US : timeout_ms * 1000)); return 0; }
+    if (poll(pfd, 4, timeout_ms) <= 0) return 0;
+    if (pfd[2].revents & POLLIN) ctl_ready = true;
+    if (!(pfd[0].revents & POLLIN)) return 0;
+
+    int changed = 0;
+#ifdef __linux__
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+    while ((n = read(watch_fd, buf, sizeof(buf))) > 0) {
+        for (char* p = buf; p < buf + n; ) {
+            struct inotify_event* ev = (struct inotify_event*)p;
+            if (ev->wd != dir_wd) roots_of_watch_dirty(ev->wd, &changed, (ev->mask & IN_IGNORED) != 0);
+            p += sizeof(*ev) + ev->len;
+        }
+    }
+#else
+    struct kevent evs[32]; struct timespec zero = { 0, 0 };
+    int n = kevent(watch_fd, NULL, 0, evs, 32, &zero);
+    for (int k = 0; k < n; k++) {
+        if (evs[k].filter == EVFILT_FS) continue; // Mount table changed: the scan rereads it
+        int i = (int)(intptr_t)evs[k].udata;
+        if (i < 0 || i >= MAX_ROOTS || !roots[i].active || roots[i].wd != (int)evs[k].ident) continue;
+        if (!roots[i].dirty) changed++;
+        root_mark_dirty(i);
+        if (evs[k].fflags & (NOTE_DELETE | NOTE_RENAME | NOTE_REVOKE)) watch_drop(i);
+    }
+#endif
+    return changed;
+}
+
+// --- MOUNT SNAPSHOT ---
+// The /system_ex/app/<id> mounts and their sources, rebuilt from the same mount table read
+// that drives device discovery. Mount state is answered from here without going through
+// nullfs into a (possibly sleeping) backing drive.
+#define SYSEX_APP_PREFIX "/system_ex/app/"
+struct MountEntry { char title_id[MAX_TITLE_ID]; char src[MAX_PATH]; uint64_t fsid; uint32_t hash; };
+struct MountEntry* mnt_entries;
+size_t mnt_count, mnt_entries_cap;
+int32_t* mnt_index;             // Open addressing over mnt_entries, -1 = empty
+size_t mnt_index_cap;
+bool mnt_valid;                 // Last mount table read succeeded
+
+static long mount_slot(const char* title_id, uint32_t hash) {
+    size_t mask = mnt_index_cap - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        int32_t k = mnt_index[i];
+        if (k < 0 || (mnt_entries[k].hash == hash && !strcmp(mnt_entries[k].title_id, title_id))) return (long)i;
+    }
+}
+
+static void mount_reset(void) {
+    mnt_count = 0;
+    if (mnt_index) memset(mnt_index, 0xff, mnt_index_cap * sizeof(*mnt_index));
+}
+
+static void mount_reindex(void) {
+    memset(mnt_index, 0xff, mnt_index_cap * sizeof(*mnt_index));
+    for (size_t k = 0; k < mnt_count; k++) mnt_index[mount_slot(mnt_entries[k].title_id, mnt_entries[k].hash)] = (int32_t)k;
+}
+
+// Records that /system_ex/app/<title_id> is mounted from `src`, which lives on the
+// filesystem `fsid` (0 if unknown)
+void mount_note(const char* title_id, const char* src, uint64_t fsid) {
+    if (strlen(title_id) >= MAX_TITLE_ID) return;
+    if ((mnt_count + 1) * 2 > mnt_index_cap) {
+        size_t cap = mnt_index_cap ? mnt_index_cap * 2 : 128;
+        int32_t* idx = (int32_t*)malloc(cap * sizeof(*idx)); if (!idx) return;
+        free(mnt_index); mnt_index = idx; mnt_index_cap = cap;
+        mount_reindex();
+    }
+    uint32_t h = hash_path(title_id);
+    long i = mount_slot(title_id, h);
+    int32_t k = mnt_index[i];
+    if (k < 0) {
+        if (mnt_count == mnt_entries_cap) {
+            size_t cap = mnt_entries_cap ? mnt_entries_cap * 2 : 64;
+            struct MountEntry* ne = (struct MountEntry*)realloc(mnt_entries, cap * sizeof(*ne)); if (!ne) return;
+            mnt_entries = ne; mnt_entries_cap = cap;
+        }
+        k = (int32_t)mnt_count++;
+        strcpy(mnt_entries[k].title_id, title_id); mnt_entries[k].hash = h;
+        mnt_index[i] = k;
+    }
+    // Stacked mounts: the last one listed is the visible one
+    strncpy(mnt_entries[k].src, src, MAX_PATH - 1); mnt_entries[k].src[MAX_PATH - 1] = '\0';
+    mnt_entries[k].fsid = fsid;
+}
+
+static void mount_table_entry(const char* target, const char* src, uint64_t fsid) {
+    size_t plen = strlen(SYSEX_APP_PREFIX);
+    if (strncmp(target, SYSEX_APP_PREFIX, plen) != 0 || !target[plen] || strchr(target + plen, '/')) return;
+    mount_note(target + plen, src, fsid);
+}
+
+// Force-unmounts every title mount served from the filesystem `fsid` mounted at `mnt`,
+// in one sweep, and drops them from the snapshot. Returns the number unmounted.
+int mount_reap_device(uint64_t fsid, const char* mnt) {
+    size_t mlen = strlen(mnt), kept = 0; int reaped = 0;
+    for (size_t k = 0; k < mnt_count; k++) {
+        struct MountEntry* e = &mnt_entries[k];
+        bool dependent = (e->fsid && e->fsid == fsid) || (!strncmp(e->src, mnt, mlen) && (e->src[mlen] == '/' || !e->src[mlen]));
+        if (!dependent) { if (kept != k) mnt_entries[kept] = *e; kept++; continue; }
+        char target[MAX_PATH]; snprintf(target, sizeof(target), SYSEX_APP_PREFIX "%s", e->title_id);
+        if (plat_unmount(target, true) != 0) log_debug("  [REAP] unmount %s FAIL: %s", target, strerror(errno));
+        reaped++;
+    }
+    if (reaped) { mnt_count = kept; mount_reindex(); }
+    return reaped;
+}
+
+// Source of the /system_ex/app/<title_id> mount, NULL if not mounted
+const char* mount_source(const char* title_id) {
+    if (!mnt_index_cap) return NULL;
+    int32_t k = mnt_index[mount_slot(title_id, hash_path(title_id))];
+    return k < 0 ? NULL : mnt_entries[k].src;
+}
+
+// Whether the mount table source `src` names `path`. Sources are cut at PLAT_MNAMELEN - 1
+// bytes (f_mntfromname), so one that long only has to be a prefix of the path.
+static bool mount_src_is(const char* src, const char* path) {
+    size_t n = strlen(src);
+    return n < PLAT_MNAMELEN - 1 ? !strcmp(src, path) : !strncmp(src, path, n);
+}
+
+// Whether the title mount made from `e` still serves the dump probe_game() just found at its
+// path. A mount outlives its source: after the dump is replaced or its drive swapped it
+// serves the old directory. Decided from the identity recorded at mount time, never by
+// stat()ing through the mount into a possibly sleeping drive. A mount the daemon did not
+// make is trusted only if the table names its source in full.
+static bool mount_current(const struct GameCache* e, const char* src) {
+    if (!e->mnt_ino) return strlen(src) < PLAT_MNAMELEN - 1;
+    return e->mnt_dev == e->dir_dev && e->mnt_ino == e->dir_ino;
+}
+
+bool is_data_mounted(const char* title_id) {
+    if (mnt_valid) return mount_source(title_id) != NULL;
+    // No mount table: fall back to probing through the mount
+    char path[MAX_PATH]; snprintf(path, sizeof(path), "/system_ex/app/%s/sce_sys/param.json", title_id); return (access(path, F_OK) == 0);
+}
+
+// --- DEVICES ---
+// Storage is discovered from the mount table once per cycle instead of probing fixed
+// /mnt/usbN paths. Every device mounted directly under MOUNT_PREFIX with a storage filesystem is
+// tracked by fsid and contributes one scan root per DEVICE_SUBDIRS entry.
+struct StorageDev {
+    uint64_t fsid;
+    char mnt[MAX_PATH];
+    char fstype[16];
+    bool present;
+    bool seen;              // Found in the current mount table read
+};
+struct StorageDev devices[MAX_DEVICES];
+
+static bool is_storage_fs(const char* fstype) {
+    for (int k = 0; STORAGE_FSTYPES[k] != NULL; k++) if (!strcmp(fstype, STORAGE_FSTYPES[k])) return true;
+    return false;
+}
+
+static void device_found(uint64_t fsid, const char* mnt, const char* fstype) {
+    // Only direct children of the prefix: /mnt/usb0 yes, /mnt/sandbox/<app>/... no
+    size_t plen = strlen(MOUNT_PREFIX);
+    if (strncmp(mnt, MOUNT_PREFIX, plen) != 0 || !mnt[plen] || strchr(mnt + plen, '/') || !is_storage_fs(fstype)) return;
+    int free_slot = -1;
+    for (int k = 0; k < MAX_DEVICES; k++) {
+        if (devices[k].present && devices[k].fsid == fsid && !strcmp(devices[k].mnt, mnt)) { devices[k].seen = true; return; }
+        if (!devices[k].present && free_slot < 0) free_slot = k;
+    }
+    if (free_slot < 0) { log_debug("[DEVICE] Ignoring %s: more than %d devices", mnt, MAX_DEVICES); return; }
+
+    struct StorageDev* dev = &devices[free_slot];
+    dev->fsid = fsid; dev->present = true; dev->seen = true;
+    strncpy(dev->mnt, mnt, sizeof(dev->mnt) - 1); dev->mnt[sizeof(dev->mnt) - 1] = '\0';
+    strncpy(dev->fstype, fstype, sizeof(dev->fstype) - 1); dev->fstype[sizeof(dev->fstype) - 1] = '\0';
+    for (int s = 0; DEVICE_SUBDIRS[s] != NULL; s++) {
+        struct ScanRoot* r = &roots[DEVICE_ROOT(free_slot, s)];
+        snprintf(r->path, sizeof(r->path), "%s%s", mnt, DEVICE_SUBDIRS[s]);
+        memset(&r->listed, 0, sizeof(r->listed));
+        r->active = true;
+    }
+    metric_inc(C_DEVICES_ADDED);
+    log_debug("[DEVICE] + %s (%s)", dev->mnt, dev->fstype);
+}
+
+// Hot-unplug reaper: drops the device's roots, force-unmounts every title mounted from
+// it and forgets which of its titles were handled, so a replug remounts them as one batch.
+// Its titles are detached from the roots too: the slot goes to the next drive plugged in.
+static void device_lost(int k) {
+    devices[k].present = false;
+    int first = DEVICE_ROOT(k, 0), last = DEVICE_ROOT(k, DEVICE_SUBDIR_COUNT - 1);
+    for (int i = first; i <= last; i++) {
+        watch_drop(i); roots[i].active = false; roots[i].dirty = false;
+    }
+    int reaped = mount_reap_device(devices[k].fsid, devices[k].mnt), dropped = 0;
+    for (size_t c = 0; c < cache_cap; c++) {
+        struct GameCache* e = cache[c];
+        if (!CACHE_LIVE(e) || e->root < first || e->root > last) continue;
+        e->root = -1;
+        if (e->install_state == INST_MOUNTED) { e->install_state = INST_UNKNOWN; index_dirty = true; } // Reaped above
+        if (e->stage == CAND_INSTALLING) continue; // Settled by install_reap()
+        wheel_cancel(e); walk_free(e);
+        e->seen = false; e->stage = CAND_NONE; e->retries = 0;
+        dropped++;
+    }
+    metric_inc(C_DEVICES_LOST); metric_add(C_MOUNTS_REAPED, (uint64_t)reaped);
+    log_debug("[DEVICE] - %s (%d mount(s) reaped, %d title(s) invalidated)", devices[k].mnt, reaped, dropped);
+}
+
+// plat_mount_table() callback
+static void mount_table_row(void* ctx, const struct PlatMount* m) {
+    (void)ctx;
+    device_found(m->fsid, m->mnt, m->fstype);
+    mount_table_entry(m->mnt, m->src, m->src_fsid);
+}
+
+// Reads the mount table once, reconciles the device list and rebuilds the mount snapshot.
+// Returns false if the table could not be read, in which case the known devices are kept as
+// they are and mount state is probed directly.
+bool devices_refresh(void) {
+    for (int k = 0; k < MAX_DEVICES; k++) devices[k].seen = false;
+    mount_reset(); mnt_valid = false;
+    if (plat_mount_table(mount_table_row, NULL) < 0) return false;
+    for (int k = 0; k < MAX_DEVICES; k++) if (devices[k].present && !devices[k].seen) device_lost(k);
+    mnt_valid = true;
+    return true;
+}
+
+// --- FAST STABILITY CHECK ---
+// A dump counts as settled once a complete walk of its tree finds nothing written for
+// SETTLE_SECS. One that was written to more recently must also look the same (total size,
+// file count, newest mtime) on a second walk, once it has been quiet that long. Walks are
+// incremental: each scan cycle shares WALK_BUDGET stat() calls across all settling dumps,
+// and the directory being read stays open between cycles. Between walks only the largest
+// files are re-stat'ed, since that is where a copy in progress usually still writes.
+struct TreeSample { uint64_t bytes, files; time_t newest; };
+struct TreeFile { char path[MAX_PATH]; off_t size; time_t mtime; };
+struct TreeWalk {
+    char** stack; int depth, cap;   // Directories still to visit
+    DIR* dir; char dir_path[MAX_PATH];
+    bool active;                    // A pass is in progress
+    int passes;
+    struct TreeSample cur, prev;
+    struct TreeFile top[WALK_TOP_FILES]; int n_top;
+};
+int walk_budget;
+
+void walk_free(struct GameCache* e) {
+    struct TreeWalk* w = e->walk; if (!w) return;
+    if (w->dir) closedir(w->dir);
+    for (int k = 0; k < w->depth; k++) free(w->stack[k]);
+    free(w->stack); free(w); e->walk = NULL;
+}
+
+static bool walk_push(struct TreeWalk* w, const char* path) {
+    if (w->depth == w->cap) {
+        int cap = w->cap ? w->cap * 2 : 16;
+        char** ns = (char**)realloc(w->stack, cap * sizeof(*ns)); if (!ns) return false;
+        w->stack = ns; w->cap = cap;
+    }
+    char* p = strdup(path); if (!p) return false;
+    w->stack[w->depth++] = p; return true;
+}
+
+static void walk_note_file(struct TreeWalk* w, const char* path, const struct stat* st) {
+    w->cur.bytes += (uint64_t)st->st_size; w->cur.files++;
+    if (st->st_mtime > w->cur.newest) w->cur.newest = st->st_mtime;
+    // Keep the WALK_TOP_FILES largest, biggest first
+    int k = (w->n_top < WALK_TOP_FILES) ? w->n_top++ : WALK_TOP_FILES;
+    while (k > 0 && w->top[k - 1].size < st->st_size) { if (k < WALK_TOP_FILES) w->top[k] = w->top[k - 1]; k--; }
+    if (k < WALK_TOP_FILES) {
+        snprintf(w->top[k].path, sizeof(w->top[k].path), "%s", path);
+        w->top[k].size = st->st_size; w->top[k].mtime = st->st_mtime;
+    }
+}
+
+static void walk_begin(struct TreeWalk* w, const char* root) {
+    struct stat st;
+    memset(&w->cur, 0, sizeof(w->cur)); w->n_top = 0; w->active = true;
+    walk_budget--;
+    if (stat(root, &st) == 0) w->cur.newest = st.st_mtime;
+    walk_push(w, root);
+}
+
+// Advances the walk within the budget. Returns true once the pass is complete.
+static bool walk_step(struct TreeWalk* w) {
+    while (walk_budget > 0) {
+        if (!w->dir) {
+            if (w->depth == 0) { w->active = false; return true; }
+            char* next = w->stack[--w->depth];
+            strncpy(w->dir_path, next, MAX_PATH - 1); w->dir_path[MAX_PATH - 1] = '\0'; free(next);
+            w->dir = opendir(w->dir_path);
+            continue;
+        }
+        struct dirent* e = readdir(w->dir);
+        if (!e) { closedir(w->dir); w->dir = NULL; continue; }
+        if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+
+        char path[MAX_PATH]; struct stat st;
+        if (!path_fmt(path, sizeof(path), "%s/%s", w->dir_path, e->d_name)) continue;
+        walk_budget--;
+        if (lstat(path, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            if (st.st_mtime > w->cur.newest) w->cur.newest = st.st_mtime;
+            walk_push(w, path);
+        } else if (S_ISREG(st.st_mode)) walk_note_file(w, path, &st);
+    }
+    return false;
+}
+
+// True if any of the largest files from the last pass changed since.
+static bool walk_top_changed(struct TreeWalk* w) {
+    for (int k = 0; k < w->n_top; k++) {
+        struct stat st; walk_budget--;
+        if (stat(w->top[k].path, &st) != 0 || st.st_size != w->top[k].size || st.st_mtime != w->top[k].mtime) return true;
+    }
+    return false;
+}
+
+// Returns 0 if the dump is settled, otherwise how long (ms) until it is worth checking
+// again. Never sleeps: the caller parks the title in the timer wheel.
+double stability_delay_ms(struct GameCache* game, const char* path, const char* name) {
+    if (walk_budget <= 0) return SETTLE_RECHECK_MS;
+    if (!game->walk && !(game->walk = (struct TreeWalk*)calloc(1, sizeof(struct TreeWalk)))) return SETTLE_RECHECK_MS;
+    struct TreeWalk* w = game->walk;
+
+    if (!w->active) {
+        if (w->passes > 0 && walk_top_changed(w)) w->passes = 0; // Still being written: start over
+        walk_begin(w, path);
+    }
+    if (!walk_step(w)) return SETTLE_RECHECK_MS; // Budget spent, continue next cycle
+
+    bool same = w->passes > 0 && w->cur.bytes == w->prev.bytes && w->cur.files == w->prev.files && w->cur.newest == w->prev.newest;
+    w->passes++; w->prev = w->cur;
+    double age = difftime(time(NULL), w->cur.newest);
+    if (age > SETTLE_SECS && (same || w->passes == 1)) return 0; // Old on the first walk, or confirmed
+
+    double wait_ms = (age >= 0 && age <= SETTLE_SECS) ? (SETTLE_SECS + 1 - age) * 1000.0 : SETTLE_RECHECK_MS;
+    if (wait_ms < SETTLE_RECHECK_MS) wait_ms = SETTLE_RECHECK_MS;
+    log_debug("  [WAIT] %s: %.1f MB in %llu files, last write %.0fs ago, rechecking in %.0fs", name,
+            w->cur.bytes / 1048576.0, (unsigned long long)w->cur.files, age, wait_ms / 1000.0);
+    return wait_ms;
+}
+
+// --- COPY ENGINE ---
+// Large aligned buffer instead of 8 KB stdio loops. On a Linux host the kernel copies
+// directly (copy_file_range), and the source is mmap'd where it cannot copy between the two
+// files (EXDEV/ENOSYS/EOPNOTSUPP). The mapping is also the fallback if no buffer can be allocated.
+// Every read/write is checked and short writes are resumed.
+// Copies are differential: a destination with the source's size and mtime is left alone,
+// and copied files get the source mtime so the next comparison is a single stat().
+struct CopyStats { uint64_t bytes, skipped_bytes; uint32_t files, skipped, errors; };
+__thread void* copy_buf; // One per install worker
+
+static bool ensure_copy_buf(void) {
+    if (!copy_buf && posix_memalign(&copy_buf, COPY_ALIGN, COPY_BUF_SIZE) != 0) copy_buf = NULL;
+    return copy_buf != NULL;
+}
+
+static bool write_all(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w; n -= (size_t)w;
+    }
+    return true;
+}
+
+// Writes bytes [done, len) of `in` to `out` straight out of a mapping of the source.
+// Returns `len`, or -1 on error.
+static int64_t copy_mapped(int in, int out, uint64_t done, uint64_t len) {
+    if (done == len) return (int64_t)done;
+    void* map = mmap(NULL, (size_t)len, PROT_READ, MAP_PRIVATE, in, 0);
+    if (map == MAP_FAILED) return -1;
+    bool ok = write_all(out, (const char*)map + done, (size_t)(len - done));
+    munmap(map, (size_t)len);
+    return ok ? (int64_t)len : -1;
+}
+
+// Copies `len` bytes from `in` to `out`. Returns bytes copied, or -1 on error.
+static int64_t copy_fd(int in, int out, uint64_t len) {
+    uint64_t done = 0;
+#ifdef __linux__
+    while (done < len) {
+        ssize_t n = copy_file_range(in, NULL, out, NULL, (size_t)(len - done), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP)) return copy_mapped(in, out, done, len); // No kernel copy between these files
+        if (n <= 0) break; // EINVAL or the source shrank: finish with the buffered path
+        done += (uint64_t)n;
+    }
+    if (done == len) return (int64_t)done;
+#endif
+    if (!ensure_copy_buf()) return copy_mapped(in, out, done, len);
+    while (done < len) {
+        ssize_t n = read(in, copy_buf, COPY_BUF_SIZE);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break; // Source shrank under us
+        if (!write_all(out, (const char*)copy_buf, (size_t)n)) return -1;
+        done += (uint64_t)n;
+    }
+    return (int64_t)done;
+}
+
+#if SYNC_VERIFY_HASH
+// FNV-1a 64 over the file contents, 0 on error
+static uint64_t hash_file(const char* path) {
+    int fd = open(path, O_RDONLY); if (fd < 0 || !ensure_copy_buf()) { if (fd >= 0) close(fd); return 0; }
+    uint64_t h = 1469598103934665603ull; ssize_t n;
+    while ((n = read(fd, copy_buf, COPY_BUF_SIZE)) > 0)
+        for (ssize_t k = 0; k < n; k++) { h ^= ((unsigned char*)copy_buf)[k]; h *= 1099511628211ull; }
+    close(fd);
+    return n < 0 ? 0 : h;
+}
+#endif
+
+static void set_mtime(int fd, const struct stat* src) {
+    struct timespec ts[2] = { src->st_atim, src->st_mtim };
+    futimens(fd, ts);
+}
+
+// True if `dst` already holds the contents of `src` (stat'ed as `st`).
+static bool sync_unchanged(const char* src, const char* dst, const struct stat* st) {
+    struct stat dt;
+    if (stat(dst, &dt) != 0 || !S_ISREG(dt.st_mode) || dt.st_size != st->st_size) return false;
+    if (dt.st_mtim.tv_sec == st->st_mtim.tv_sec && dt.st_mtim.tv_nsec == st->st_mtim.tv_nsec) return true;
+#if SYNC_VERIFY_HASH
+    uint64_t h = hash_file(src);
+    if (h != 0 && h == hash_file(dst)) {
+        int fd = open(dst, O_WRONLY); if (fd >= 0) { set_mtime(fd, st); close(fd); }
+        return true;
+    }
+#else
+    (void)src;
+#endif
+    return false;
+}
+
+int copy_file(const char* src, const char* dst, struct CopyStats* cs) {
+    int in = open(src, O_RDONLY); if (in < 0) { cs->errors++; return -1; }
+    struct stat st;
+    if (fstat(in, &st) != 0) { close(in); cs->errors++; return -1; }
+    if (sync_unchanged(src, dst, &st)) { close(in); cs->skipped++; cs->skipped_bytes += (uint64_t)st.st_size; return 0; }
+    int out = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (out < 0) { log_debug("  [COPY] FAIL %s: %s", dst, strerror(errno)); close(in); cs->errors++; return -1; }
+
+    int64_t n = copy_fd(in, out, (uint64_t)st.st_size);
+    bool ok = (n == (int64_t)st.st_size);
+    if (ok) set_mtime(out, &st);
+    if (close(out) != 0) ok = false;
+    close(in);
+    if (!ok) { log_debug("  [COPY] FAIL %s: %s", dst, n < 0 ? strerror(errno) : "short copy"); cs->errors++; return -1; }
+    cs->bytes += (uint64_t)n; cs->files++;
+    return 0;
+}
+
+int copy_dir(const char* src, const char* dst, struct CopyStats* cs) {
+    mkdir(dst, 0777); DIR* d = opendir(src); if (!d) { cs->errors++; return -1; }
+    struct dirent* e; char ss[MAX_PATH], dd[MAX_PATH]; struct stat st; int rc = 0;
+    while ((e = readdir(d))) {
+        if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+        snprintf(ss, sizeof(ss), "%s/%s", src, e->d_name); snprintf(dd, sizeof(dd), "%s/%s", dst, e->d_name);
+        if (stat(ss, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) { if (copy_dir(ss, dd, cs) != 0) rc = -1; }
+        else if (copy_file(ss, dd, cs) != 0) rc = -1;
+    }
+    closedir(d); return rc;
+}
+
+// --- JSON & DRM ---
+// param.json is read once into a reusable buffer. Retail files take a fast path that
+// searches for the few members we need (see parse_param_fast); anything else is walked
+// once, picking up every field we care about on the way.
+#define PARAM_MAX_SIZE  (1024 * 1024 * 5)
+#define JSON_MAX_DEPTH  32
+#define MAX_LOCALES     64
+enum { JCTX_NONE, JCTX_ROOT, JCTX_LOCALIZED, JCTX_LOCALE, JCTX_OTHER };
+
+struct JsonScan {
+    struct ParamInfo* info;
+    const char* buf; const char* end;
+    bool eof;                           // Input ended inside a value: truncated, not malformed
+    char default_lang[16];
+    const char* any_name;               // First titleName anywhere, last resort
+    const char* en_name;                // en-US is always preferred, even past MAX_LOCALES
+    int n_locales, cur_locale;
+    char cur_key[16];
+    char locale_key[MAX_LOCALES][16];
+    const char* locale_name[MAX_LOCALES];
+};
+
+char* param_buf;
+size_t param_cap, param_len;  // param_len: bytes of the last file read into param_buf
+int drm_rewrites;             // param.json files patched during the current cycle
+
+// JSON whitespace only; isspace() is a locale table lookup per byte
+static bool json_is_ws(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+static const char* json_ws(const char* p, const char* end) {
+    while (p < end && json_is_ws(*p)) p++;
+    return p;
+}
+
+static int hex4(const char* p) {
+    int v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i]; v <<= 4;
+        if (c >= '0' && c <= '9') v |= c - '0';
+        else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+        else return -1;
+    }
+    return v;
+}
+
+static size_t utf8_put(char* out, unsigned cp) {
+    if (cp < 0x80) { out[0] = (char)cp; return 1; }
+    if (cp < 0x800) { out[0] = (char)(0xC0 | (cp >> 6)); out[1] = (char)(0x80 | (cp & 0x3F)); return 2; }
+    if (cp < 0x10000) { out[0] = (char)(0xE0 | (cp >> 12)); out[1] = (char)(0x80 | ((cp >> 6) & 0x3F)); out[2] = (char)(0x80 | (cp & 0x3F)); return 3; }
+    out[0] = (char)(0xF0 | (cp >> 18)); out[1] = (char)(0x80 | ((cp >> 12) & 0x3F)); out[2] = (char)(0x80 | ((cp >> 6) & 0x3F)); out[3] = (char)(0x80 | (cp & 0x3F)); return 4;
+}
+
+// Parses the string at `p` (pointing at the opening quote). Unescaped contents go to
+// `out` (truncated, may be NULL). Returns the position after the closing quote.
+static const char* json_string(const char* p, const char* end, char* out, size_t out_size) {
+    size_t n = 0;
+    if (p >= end || *p != '"') return NULL;
+    if (!out) {
+        // Skip only: jump between quotes, a quote preceded by an odd run of backslashes is escaped
+        for (const char* q = p + 1; (q = (const char*)memchr(q, '"', (size_t)(end - q))) != NULL; q++) {
+            const char* b = q; while (b > p + 1 && b[-1] == '\\') b--;
+            if (((q - b) & 1) == 0) return q + 1;
+        }
+        return NULL;
+    }
+    for (p++; p < end; p++) {
+        // Plain runs are copied in one go
+        const char* r = (const char*)memchr(p, '"', (size_t)(end - p)); if (!r) return NULL;
+        const char* esc = (const char*)memchr(p, '\\', (size_t)(r - p)); if (esc) r = esc;
+        if (r > p) {
+            size_t run = (size_t)(r - p); if (run > out_size - 1 - n) run = out_size - 1 - n;
+            memcpy(out + n, p, run); n += run; p = r;
+        }
+        char tmp[4]; size_t len = 1; tmp[0] = *p;
+        if (*p == '"') { out[n] = '\0'; return p + 1; }
+        if (*p == '\\') {
+            if (++p >= end) return NULL;
+            switch (*p) {
+                case 'b': tmp[0] = '\b'; break; case 'f': tmp[0] = '\f'; break;
+                case 'n': tmp[0] = '\n'; break; case 'r': tmp[0] = '\r'; break;
+                case 't': tmp[0] = '\t'; break;
+                case 'u': {
+                    if (end - p < 5) return NULL;
+                    int cp = hex4(p + 1); if (cp < 0) return NULL; p += 4;
+                    if (cp >= 0xD800 && cp <= 0xDBFF && end - p >= 7 && p[1] == '\\' && p[2] == 'u') {
+                        int lo = hex4(p + 3);
+                        if (lo >= 0xDC00 && lo <= 0xDFFF) { cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00); p += 6; }
+                    }
+                    len = utf8_put(tmp, (unsigned)cp);
+                    break;
+                }
+                default: tmp[0] = *p; break; // \" \\ \/
+            }
+        }
+        if (n + len < out_size) { memcpy(out + n, tmp, len); n += len; }
+    }
+    return NULL;
+}
 
-// Standard Notification
-typedef struct notify_request { char unused[45]; char message[3075]; } notify_request_t;
-int sceKernelSendNotificationRequest(int, notify_request_t*, size_t, int);
+static void json_take(const char* value, const char* end, char* out, size_t out_size) {
+    if (!json_string(value, end, out, out_size)) out[0] = '\0';
+}
 
-// Scan Paths
-const char* SCAN_PATHS[] = {
-    // Internal
-    "/data/homebrew", "/data/etaHEN/games",
-    
-    // USB Subfolders
-    "/mnt/usb0/homebrew", "/mnt/usb1/homebrew", "/mnt/usb2/homebrew", "/mnt/usb3/homebrew",
-    "/mnt/usb4/homebrew", "/mnt/usb5/homebrew", "/mnt/usb6/homebrew", "/mnt/usb7/homebrew",
-    
-    "/mnt/usb0/etaHEN/games", "/mnt/usb1/etaHEN/games", "/mnt/usb2/etaHEN/games", "/mnt/usb3/etaHEN/games",
-    "/mnt/usb4/etaHEN/games", "/mnt/usb5/etaHEN/games", "/mnt/usb6/etaHEN/games", "/mnt/usb7/etaHEN/games",
+// Handles a string member `key` = `value` found in container context `ctx`.
+static void json_on_string(struct JsonScan* s, int ctx, const char* key, const char* value, const char* value_end) {
+    struct ParamInfo* info = s->info;
+    if (ctx == JCTX_ROOT) {
+        if (!strcmp(key, "titleId") || (!strcmp(key, "title_id") && !info->title_id[0])) json_take(value, s->end, info->title_id, sizeof(info->title_id));
+        else if (!strcmp(key, "contentId")) json_take(value, s->end, info->content_id, sizeof(info->content_id));
+        else if (!strcmp(key, "contentVersion") || (!strcmp(key, "version") && !info->version[0])) json_take(value, s->end, info->version, sizeof(info->version));
+        else if (!strcmp(key, "applicationDrmType")) {
+            json_take(value, s->end, info->drm_type, sizeof(info->drm_type));
+            info->drm_off = (long)(value + 1 - s->buf); info->drm_len = (long)(value_end - 1 - (value + 1));
+        }
+    } else if (ctx == JCTX_LOCALIZED && !strcmp(key, "defaultLanguage")) {
+        json_take(value, s->end, s->default_lang, sizeof(s->default_lang));
+    } else if (ctx == JCTX_LOCALE && !strcmp(key, "titleName")) {
+        if (!strcmp(s->cur_key, "en-US")) s->en_name = value;
+        if (s->cur_locale >= 0) s->locale_name[s->cur_locale] = value;
+    }
+    if (!s->any_name && !strcmp(key, "titleName")) s->any_name = value;
+}
 
-    // USB Root Paths
-    "/mnt/usb0", "/mnt/usb1", "/mnt/usb2", "/mnt/usb3",
-    "/mnt/usb4", "/mnt/usb5", "/mnt/usb6", "/mnt/usb7",
-    "/mnt/ext0", "/mnt/ext1",
-    
-    NULL
-};
+static const char* json_value(struct JsonScan* s, const char* p, int depth, int ctx, const char* key);
 
-struct GameCache { 
-    char path[MAX_PATH]; 
-    char title_id[MAX_TITLE_ID]; 
-    char title_name[MAX_TITLE_NAME]; 
-    bool valid; 
-};
-struct GameCache cache[MAX_PENDING];
+// Skips the container at `p` without looking at its members: strings are jumped with
+// memchr, and only the bytes between them are checked for brackets. Returns the position
+// after its closing bracket.
+static const char* json_skip(struct JsonScan* s, const char* p) {
+    int depth = 0;
+    for (; p < s->end; p++) {
+        if (*p == '"') { p = json_string(p, s->end, NULL, 0); if (!p) break; p--; }
+        else if (*p == '{' || *p == '[') depth++;
+        else if ((*p == '}' || *p == ']') && --depth == 0) return p + 1;
+    }
+    s->eof = true;
+    return NULL;
+}
 
-// --- LOGGING ---
-void log_to_file(const char* fmt, va_list args) {
-    mkdir(LOG_DIR, 0777);
-    FILE* fp = fopen(LOG_FILE, "a");
-    if (fp) {
-        time_t rawtime; struct tm * timeinfo; char buffer[80];
-        time(&rawtime); timeinfo = localtime(&rawtime); strftime(buffer, sizeof(buffer), "%H:%M:%S", timeinfo);
-        fprintf(fp, "[%s] ", buffer); vfprintf(fp, fmt, args); fprintf(fp, "\n"); fclose(fp);
+static const char* json_container(struct JsonScan* s, const char* p, int depth, int ctx) {
+    bool is_obj = (*p == '{'); char close = is_obj ? '}' : ']';
+    p = json_ws(p + 1, s->end);
+    if (p < s->end && *p == close) return p + 1;
+    while (p < s->end) {
+        char key[64] = "";
+        if (is_obj) {
+            if (*p != '"') return NULL;
+            p = json_string(p, s->end, key, sizeof(key)); if (!p) { s->eof = true; return NULL; }
+            p = json_ws(p, s->end); if (p >= s->end) break;
+            if (*p != ':') return NULL;
+            p = json_ws(p + 1, s->end);
+            if (ctx == JCTX_LOCALIZED && p < s->end && *p == '{') {
+                // A key too long for a language code is kept as an unnamed locale
+                if (snprintf(s->cur_key, sizeof(s->cur_key), "%s", key) >= (int)sizeof(s->cur_key)) s->cur_key[0] = '\0';
+                if (s->n_locales < MAX_LOCALES) {
+                    s->cur_locale = s->n_locales++;
+                    memcpy(s->locale_key[s->cur_locale], s->cur_key, sizeof(s->cur_key));
+                    s->locale_name[s->cur_locale] = NULL;
+                } else s->cur_locale = -1;
+            }
+        }
+        p = json_value(s, p, depth + 1, ctx, is_obj ? key : NULL); if (!p) return NULL;
+        p = json_ws(p, s->end);
+        if (p < s->end && *p == ',') {
+            p = json_ws(p + 1, s->end);
+            if (p < s->end && *p == close) return p + 1; // Trailing comma, common in hand-written files
+            continue;
+        }
+        if (p < s->end && *p == close) return p + 1;
+        if (p < s->end) return NULL;
     }
+    s->eof = true;
+    return NULL;
 }
-void log_debug(const char* fmt, ...) {
-    va_list args; va_start(args, fmt); vprintf(fmt, args); printf("\n"); log_to_file(fmt, args); va_end(args);
+
+// `ctx` is the context of the container holding this value, `key` its member name.
+static const char* json_value(struct JsonScan* s, const char* p, int depth, int ctx, const char* key) {
+    if (p >= s->end) { s->eof = true; return NULL; }
+    if (depth > JSON_MAX_DEPTH) return NULL;
+    if (*p == '"') {
+        const char* q = json_string(p, s->end, NULL, 0);
+        if (!q) s->eof = true;
+        else if (key) json_on_string(s, ctx, key, p, q);
+        return q;
+    }
+    if (*p == '{' || *p == '[') {
+        int child = JCTX_OTHER;
+        if (ctx == JCTX_NONE && *p == '{') child = JCTX_ROOT;
+        else if (ctx == JCTX_ROOT && key && !strcmp(key, "localizedParameters")) child = JCTX_LOCALIZED;
+        else if (ctx == JCTX_LOCALIZED && key && *p == '{') child = JCTX_LOCALE;
+        // Nothing left to take from it: past MAX_LOCALES only en-US is still looked at
+        if (s->any_name && (child == JCTX_OTHER || (child == JCTX_LOCALE && s->cur_locale < 0 && strcmp(key, "en-US"))))
+            return json_skip(s, p);
+        return json_container(s, p, depth, child);
+    }
+    while (p < s->end && *p != ',' && *p != '}' && *p != ']' && !json_is_ws(*p)) p++; // number, true, false, null
+    return p;
 }
 
-// --- NOTIFICATIONS ---
-void notify_system(const char* fmt, ...) {
-    notify_request_t req; memset(&req, 0, sizeof(req));
-    va_list args; va_start(args, fmt); vsnprintf(req.message, sizeof(req.message), fmt, args); va_end(args);
-    sceKernelSendNotificationRequest(0, &req, sizeof(req), 0);
-    log_debug("NOTIFY: %s", req.message);
+// Start of the root value: past a UTF-8 BOM (left by some Windows editors) and whitespace
+static const char* json_start(const char* buf, const char* end) {
+    if (end - buf >= 3 && !memcmp(buf, "\xEF\xBB\xBF", 3)) buf += 3;
+    return json_ws(buf, end);
 }
 
-void trigger_rich_toast(const char* title_id, const char* game_name, const char* msg) {
-    FILE* f = fopen(TOAST_FILE, "w");
-    if (f) {
-        fprintf(f, "%s|%s|%s", title_id, game_name, msg);
-        fflush(f); fclose(f);
+// Walks `buf` once. Malformed input keeps whatever was extracted before the error.
+// Returns false only if the input ended before the root object closed: a file still being
+// written, whose fields (drm_off in particular) are not trusted. A trailing comma is
+// accepted; any other syntax error is accepted once titleId has been extracted.
+static bool parse_param_walk(const char* buf, size_t len, struct ParamInfo* info) {
+    struct JsonScan s; memset(&s, 0, sizeof(s));
+    memset(info, 0, sizeof(*info)); info->drm_off = -1;
+    s.info = info; s.buf = buf; s.end = buf + len; s.cur_locale = -1;
+    const char* p = json_start(buf, s.end);
+    bool closed = p < s.end && *p == '{' && json_value(&s, p, 0, JCTX_NONE, NULL) != NULL;
+
+    // Title preference: en-US, then the default language, then any locale, then any titleName
+    const char* name = s.en_name;
+    for (int i = 0; i < s.n_locales && !name; i++) if (s.default_lang[0] && !strcmp(s.locale_key[i], s.default_lang)) name = s.locale_name[i];
+    for (int i = 0; i < s.n_locales && !name; i++) name = s.locale_name[i];
+    if (!name) name = s.any_name;
+    if (name) json_take(name, s.end, info->title_name, sizeof(info->title_name));
+    return closed || (p < s.end && !s.eof && info->title_id[0]);
+}
+
+// Value of the member whose quoted name `key` (key_len bytes) starts at `k`, or NULL if `k`
+// is not a member name: it must follow '{' or ',' and be followed by ':'. An escaped quote
+// can never match, so hits inside string values are ruled out too.
+static const char* json_member_at(const char* buf, const char* k, const char* end, size_t key_len) {
+    const char* b = k; while (b > buf && json_is_ws(b[-1])) b--;
+    if (b == buf || (b[-1] != '{' && b[-1] != ',')) return NULL;
+    const char* v = json_ws(k + key_len, end);
+    if (v >= end || *v != ':') return NULL;
+    v = json_ws(v + 1, end);
+    return v < end ? v : NULL;
+}
+
+// Value of the first member `key` (with its quotes) named at or after `p`. strstr is the
+// fastest forward search in libc here, so `buf` must be NUL-terminated.
+static const char* json_find(const char* buf, const char* p, const char* end, const char* key) {
+    size_t n = strlen(key);
+    for (const char* k = p; (k = strstr(k, key)) != NULL && k < end; k++) {
+        const char* v = json_member_at(buf, k, end, n); if (v) return v;
     }
+    return NULL;
 }
 
-// --- FILESYSTEM ---
-bool is_installed(const char* title_id) { char path[MAX_PATH]; snprintf(path, sizeof(path), "/user/app/%s", title_id); struct stat st; return (stat(path, &st) == 0); }
-bool is_data_mounted(const char* title_id) { char path[MAX_PATH]; snprintf(path, sizeof(path), "/system_ex/app/%s/sce_sys/param.json", title_id); return (access(path, F_OK) == 0); }
+// First uppercase letter of `key` (with its quotes), which is rare in param.json (camelCase
+// names, mostly lowercase values), or its closing quote
+static size_t json_anchor(const char* key, size_t n) {
+    for (size_t i = 1; i + 1 < n; i++) if (key[i] >= 'A' && key[i] <= 'Z') return i;
+    return n - 1;
+}
 
-// --- FAST STABILITY CHECK ---
-bool wait_for_stability_fast(const char* path, const char* name) {
-    struct stat st;
-    time_t now = time(NULL);
+// Value of the first member `key` named in [p, limit). For members that may be missing:
+// strstr would run on to the end of the buffer. Searched with memchr on its anchor, then
+// compared in full.
+static const char* json_find_before(const char* buf, const char* p, const char* limit, const char* end, const char* key) {
+    size_t n = strlen(key), a = json_anchor(key, n);
+    if (limit - p < (long)n) return NULL;
+    const char* last = limit - (n - a); // Anchor of the last place the key fits
+    for (const char* c = p + a; c <= last && (c = (const char*)memchr(c, key[a], (size_t)(last - c) + 1)) != NULL; c++) {
+        if (memcmp(c - a, key, n) == 0) { const char* v = json_member_at(buf, c - a, end, n); if (v) return v; }
+    }
+    return NULL;
+}
 
-    // 1. Check Root Folder Timestamp
-    if (stat(path, &st) != 0) return false; 
-    double diff = difftime(now, st.st_mtime);
-
-    // If modified > 10 seconds ago, it's stable.
-    if (diff > 10.0) {
-        // Double check sce_sys just to be sure
-        char sys_path[MAX_PATH];
-        snprintf(sys_path, sizeof(sys_path), "%s/sce_sys", path);
-        if (stat(sys_path, &st) == 0) {
-            if (difftime(now, st.st_mtime) > 10.0) {
-                 return true;
-            }
-        } else {
-             return true; // No sce_sys? Trust root.
-        }
+// Value of the last member `key` (with its quotes) in `buf`. Searched backwards with memrchr
+// on its anchor, then compared in full.
+static const char* json_rfind(const char* buf, const char* end, const char* key) {
+    size_t n = strlen(key), a = json_anchor(key, n);
+    if ((size_t)(end - buf) < n) return NULL;
+    for (const char* c = end - (n - a); (c = (const char*)memrchr(buf + a, key[a], (size_t)(c - (buf + a)) + 1)) != NULL; c--) {
+        if (memcmp(c - a, key, n) == 0) { const char* v = json_member_at(buf, c - a, end, n); if (v) return v; }
+        if (c == buf + a) break;
     }
-    
-    
-    log_debug("  [WAIT] %s modified %.0fs ago. Waiting...", name, diff);
-    sceKernelUsleep(2000000); // Wait 2s
-    return false; // Force re-scan next cycle
+    return NULL;
 }
 
-static int remount_system_ex(void) {
-    struct iovec iov[] = { IOVEC_ENTRY("from"), IOVEC_ENTRY("/dev/ssd0.system_ex"), IOVEC_ENTRY("fspath"), IOVEC_ENTRY("/system_ex"), IOVEC_ENTRY("fstype"), IOVEC_ENTRY("exfatfs"), IOVEC_ENTRY("large"), IOVEC_ENTRY("yes"), IOVEC_ENTRY("timezone"), IOVEC_ENTRY("static"), IOVEC_ENTRY("async"), IOVEC_ENTRY(NULL), IOVEC_ENTRY("ignoreacl"), IOVEC_ENTRY(NULL) };
-    return nmount(iov, IOVEC_SIZE(iov), MNT_UPDATE);
+// Value of the member `key` if it is the one named at `p` (after whitespace), else NULL.
+// Cheaper than a search where the member usually is.
+static inline const char* json_member_here(const char* buf, const char* p, const char* end, const char* key) {
+    size_t n = strlen(key); p = json_ws(p, end);
+    return (size_t)(end - p) > n && !memcmp(p, key, n) ? json_member_at(buf, p, end, n) : NULL;
 }
-static int mount_nullfs(const char* src, const char* dst) {
-    struct iovec iov[] = { IOVEC_ENTRY("fstype"), IOVEC_ENTRY("nullfs"), IOVEC_ENTRY("from"), IOVEC_ENTRY(src), IOVEC_ENTRY("fspath"), IOVEC_ENTRY(dst) };
-    return nmount(iov, IOVEC_SIZE(iov), MNT_RDONLY); 
+
+// Fast path for retail files, which are machine-written with sorted keys: instead of walking
+// every value, search for the members we need in the order they appear, each from the
+// previous hit; titleName is first looked for as en-US's first member, and titleId, which
+// sorts after localizedParameters, is searched from the back. contentId and contentVersion
+// are only logged and may be missing: contentVersion is expected right after contentId and
+// otherwise looked for before localizedParameters. Every search stops at its member, so
+// about the bytes the old strstr lookups scanned are looked at. applicationDrmType is left
+// out: only the migration needs it, and that walks the file. Returns false if a required
+// member is missing or out of order; the caller then walks the whole file.
+static bool parse_param_fast(const char* buf, const char* root, const char* end, struct ParamInfo* info) {
+    const char* cid = json_find(buf, root, end, "\"contentId\"");
+    if (cid && *cid != '"') return false;
+    const char* loc = json_find(buf, cid ? cid : root, end, "\"localizedParameters\"");
+    if (!loc || *loc != '{') return false;
+    const char* en = json_find(buf, loc, end, "\"en-US\"");
+    if (!en || *en != '{') return false;
+    const char* name = json_member_here(buf, en + 1, end, "\"titleName\""); // Usually its only member
+    if (!name) name = json_find(buf, en, end, "\"titleName\"");
+    if (!name || *name != '"' || memchr(en, '}', (size_t)(name - en))) return false; // Not en-US's own titleName
+    const char* id = json_rfind(buf, end, "\"titleId\"");
+    if (!id || id < loc || *id != '"') return false;
+
+    // Every other field is written, so the struct is not cleared first
+    info->drm_type[0] = '\0'; info->drm_off = -1; info->drm_len = 0;
+    info->content_id[0] = '\0'; info->version[0] = '\0';
+    const char* ver = NULL, *p = cid ? json_string(cid, end, info->content_id, sizeof(info->content_id)) : NULL;
+    if (p && (p = json_ws(p, end)) < end && *p == ',') ver = json_member_here(buf, p + 1, end, "\"contentVersion\"");
+    if (!ver) ver = json_find_before(buf, cid ? cid : root, loc, end, "\"contentVersion\"");
+    if (ver && *ver == '"') json_take(ver, end, info->version, sizeof(info->version));
+    json_take(name, end, info->title_name, sizeof(info->title_name));
+    json_take(id, end, info->title_id, sizeof(info->title_id));
+    return info->title_id[0] != '\0';
 }
-static int copy_dir(const char* src, const char* dst) {
-    mkdir(dst, 0777); DIR* d = opendir(src); if (!d) return -1;
-    struct dirent* e; char ss[MAX_PATH], dd[MAX_PATH]; struct stat st;
-    while ((e = readdir(d))) {
-        if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
-        snprintf(ss, sizeof(ss), "%s/%s", src, e->d_name); snprintf(dd, sizeof(dd), "%s/%s", dst, e->d_name);
-        if (stat(ss, &st) != 0) continue;
-        if (S_ISDIR(st.st_mode)) copy_dir(ss, dd);
-        else {
-            FILE* fs = fopen(ss, "rb"); if (!fs) continue;
-            FILE* fd = fopen(dd, "wb"); if (!fd) { fclose(fs); continue; }
-            char buf[8192]; size_t n; while ((n = fread(buf, 1, sizeof(buf), fs)) > 0) fwrite(buf, 1, n, fd);
-            fclose(fd); fclose(fs);
-        }
-    }
-    closedir(d); return 0;
+
+// Extracts the fields we need from `buf`, which must be NUL-terminated at `len` (as
+// read_param_file leaves it). Returns false if the file is truncated, i.e. still being
+// written; see parse_param_walk for what else is accepted. The fast path only looks at
+// the last byte for truncation, so callers about to rewrite the file walk it instead.
+bool parse_param_json(const char* buf, size_t len, struct ParamInfo* info) {
+    const char* end = buf + len;
+    const char* root = json_start(buf, end);
+    const char* tail = end; while (tail > root && json_is_ws(tail[-1])) tail--;
+    if (root < tail && *root == '{' && tail[-1] == '}' && parse_param_fast(buf, root, end, info)) return true;
+    return parse_param_walk(buf, len, info);
 }
-int copy_file(const char* src, const char* dst) {
-    char buf[8192]; FILE* fs = fopen(src, "rb"); if (!fs) return -1;
-    FILE* fd = fopen(dst, "wb"); if (!fd) { fclose(fs); return -1; }
-    size_t n; while ((n = fread(buf, 1, sizeof(buf), fs)) > 0) fwrite(buf, 1, n, fd);
-    fclose(fd); fclose(fs); return 0;
+
+// Reads `path` into the shared parse buffer. Returns its length or -1.
+static long read_param_file(const char* path) {
+    int fd = open(path, O_RDONLY); if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || st.st_size > PARAM_MAX_SIZE) { close(fd); return -1; }
+    size_t len = (size_t)st.st_size;
+    if (len + 1 > param_cap) {
+        char* nb = (char*)realloc(param_buf, len + 1); if (!nb) { close(fd); return -1; }
+        param_buf = nb; param_cap = len + 1;
+    }
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = read(fd, param_buf + got, len - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    close(fd);
+    param_buf[got] = '\0'; param_len = got;
+    return (long)got;
 }
 
-// --- JSON & DRM ---
-static int extract_json_string(const char* json, const char* key, char* out, size_t out_size) {
-    char search[64]; snprintf(search, sizeof(search), "\"%s\"", key);
-    const char* p = strstr(json, search); if (!p) return -1;
-    p = strchr(p + strlen(search), ':'); if (!p) return -2;
-    while (*++p && isspace(*p)) { /*skip*/ } if (*p != '"') return -3; p++;
-    size_t i = 0; while (i < out_size - 1 && p[i] && p[i] != '"') { out[i] = p[i]; i++; } out[i] = '\0'; return 0;
-}
-static int fix_application_drm_type(const char* path) {
-    FILE* f = fopen(path, "rb+"); if (!f) return -1;
-    fseek(f, 0, SEEK_END); long len = ftell(f); fseek(f, 0, SEEK_SET);
-    if (len <= 0 || len > 1024 * 1024 * 5) { fclose(f); return -1; } 
-    char* buf = (char*)malloc(len + 1); fread(buf, 1, len, f); buf[len] = '\0'; 
-    const char* key = "\"applicationDrmType\""; char* p = strstr(buf, key);
-    if (!p) { free(buf); fclose(f); return 0; }
-    char* colon = strchr(p + strlen(key), ':'); char* q1 = colon ? strchr(colon, '"') : NULL; char* q2 = q1 ? strchr(q1 + 1, '"') : NULL;
-    if (!q1 || !q2) { free(buf); fclose(f); return -1; }
-    if ((q2 - q1 - 1) == strlen("standard") && !strncmp(q1 + 1, "standard", strlen("standard"))) { free(buf); fclose(f); return 0; }
-    size_t new_len = (q1 - buf) + 1 + strlen("standard") + 1 + strlen(q2 + 1);
-    char* out = (char*)malloc(new_len + 1);
-    memcpy(out, buf, q1 - buf + 1); memcpy(out + (q1 - buf + 1), "standard", strlen("standard")); strcpy(out + (q1 - buf + 1 + strlen("standard")), q2);
-    fseek(f, 0, SEEK_SET); fwrite(out, 1, strlen(out), f); fclose(f); 
-    free(buf); free(out); return 1;
-}
-
-bool get_game_info(const char* base_path, char* out_id, char* out_name) {
+bool get_game_info(const char* base_path, struct ParamInfo* info) {
+    TRACE_SCOPE("get_game_info", base_path);
     char path[MAX_PATH]; snprintf(path, sizeof(path), "%s/sce_sys/param.json", base_path);
-    fix_application_drm_type(path); 
-    FILE* f = fopen(path, "rb");
-    if (f) {
-        fseek(f, 0, SEEK_END); long len = ftell(f); fseek(f, 0, SEEK_SET);
-        if (len > 0) {
-            char* buf = (char*)malloc(len + 1);
-            if (buf) {
-                fread(buf, 1, len, f); buf[len] = '\0';
-                int res = extract_json_string(buf, "titleId", out_id, MAX_TITLE_ID);
-                if (res != 0) res = extract_json_string(buf, "title_id", out_id, MAX_TITLE_ID);
-                if (res == 0) {
-                    const char* en_ptr = strstr(buf, "\"en-US\""); const char* search_start = en_ptr ? en_ptr : buf;
-                    if (extract_json_string(search_start, "titleName", out_name, MAX_TITLE_NAME) != 0) extract_json_string(buf, "titleName", out_name, MAX_TITLE_NAME);
-                    if (strlen(out_name) == 0) strncpy(out_name, out_id, MAX_TITLE_NAME);
-                    free(buf); fclose(f); return true;
-                }
-                free(buf);
-            }
-        }
-        fclose(f);
+    metric_inc(C_PARAM_PARSES); double t0 = now_ms();
+    long len = read_param_file(path); if (len <= 0) return false;
+    bool complete = parse_param_json(param_buf, (size_t)len, info);
+    hist_since(H_PARSE, t0);
+    if (!complete) { log_debug("  [PARAM] %s: truncated, not ready", path); return false; }
+    if (!info->title_id[0]) return false;
+    if (!info->title_name[0]) strncpy(info->title_name, info->title_id, MAX_TITLE_NAME);
+    return true;
+}
+
+static bool fingerprint_matches(const struct GameCache* e, const struct stat* st) {
+    return e->dev == (uint64_t)st->st_dev && e->ino == (uint64_t)st->st_ino && e->mtime == (int64_t)st->st_mtime && e->size == (int64_t)st->st_size;
+}
+
+// One-time migration of applicationDrmType to "standard", run once the dump has settled,
+// right before it is mounted. The file is read again, must still match the probed
+// fingerprint and is walked to the end of its root object; it is then patched in param_buf
+// and swapped in with write-to-temp, fsync and rename. The original mtimes of param.json
+// and sce_sys are put back, so the daemon's own write never looks like a copy in progress.
+// Returns DRM_UNCHECKED if the file changed since the probe; a failed attempt is not
+// retried until the file changes.
+static uint8_t migrate_drm_type(struct GameCache* e) {
+    TRACE_SCOPE("drm_migrate", e->path);
+    char path[MAX_PATH], tmp[MAX_PATH], sys[MAX_PATH];
+    if (!path_fmt(path, sizeof(path), "%s/sce_sys/param.json", e->path) || !path_fmt(tmp, sizeof(tmp), "%s/sce_sys/param.json.smtmp", e->path) ||
+        !path_fmt(sys, sizeof(sys), "%s/sce_sys", e->path)) return DRM_FAILED; // No room for the temp file name
+
+    struct stat st, sys_st; metric_add(C_STAT_CALLS, 2);
+    if (stat(path, &st) != 0 || !fingerprint_matches(e, &st) || stat(sys, &sys_st) != 0) return DRM_UNCHECKED;
+    struct ParamInfo info; metric_inc(C_PARAM_PARSES);
+    long len = read_param_file(path);
+    if (len <= 0) return DRM_UNCHECKED;
+    if (!parse_param_walk(param_buf, (size_t)len, &info)) { // Settled and unchanged, yet cut short
+        log_debug("  [DRM] FAIL %s: truncated", path);
+        return DRM_FAILED;
     }
-    return false;
+    if (info.drm_off < 0 || !strcmp(info.drm_type, "standard")) return DRM_CLEAN;
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, st.st_mode & 0777);
+    if (fd < 0) { log_debug("  [DRM] FAIL %s: %s", path, strerror(errno)); return DRM_FAILED; }
+    size_t tail = (size_t)(info.drm_off + info.drm_len);
+    struct iovec iov[] = {
+        { param_buf, (size_t)info.drm_off },
+        { (void*)"standard", strlen("standard") },
+        { param_buf + tail, param_len - tail },
+    };
+    size_t want = iov[0].iov_len + iov[1].iov_len + iov[2].iov_len;
+    bool ok = (writev(fd, iov, IOVEC_SIZE(iov)) == (ssize_t)want) && (fsync(fd) == 0);
+    if (close(fd) != 0) ok = false;
+    if (!ok || rename(tmp, path) != 0) {
+        log_debug("  [DRM] FAIL %s: %s", path, strerror(errno));
+        remove(tmp); return DRM_FAILED;
+    }
+    struct timespec ts[2] = { st.st_atim, st.st_mtim }, sys_ts[2] = { sys_st.st_atim, sys_st.st_mtim };
+    utimensat(AT_FDCWD, path, ts, 0);
+    utimensat(AT_FDCWD, sys, sys_ts, 0);
+    if (stat(path, &st) == 0) { e->dev = st.st_dev; e->ino = st.st_ino; e->mtime = st.st_mtime; e->size = st.st_size; }
+    metric_inc(C_STAT_CALLS); index_dirty = true;
+
+    drm_rewrites++; metric_inc(C_DRM_REWRITES);
+    log_debug("  [DRM] %s: %s -> standard", info.title_id, info.drm_type);
+    return DRM_PATCHED;
+}
+
+// Cached front end for get_game_info(): one stat() for known non-games, and
+// param.json is only parsed when its (dev, ino, mtime, size) fingerprint moved.
+struct GameCache* probe_game(const char* full_path) {
+    struct stat st, pst; metric_inc(C_STAT_CALLS);
+    if (stat(full_path, &st) != 0 || !S_ISDIR(st.st_mode)) return NULL;
+    if (neg_cache_hit(full_path, &st)) return NULL;
+
+    char param[MAX_PATH]; snprintf(param, sizeof(param), "%s/sce_sys/param.json", full_path);
+    struct GameCache* e = cache_find(full_path);
+    bool have_param = (stat(param, &pst) == 0); metric_inc(C_STAT_CALLS);
+    if (e && have_param && fingerprint_matches(e, &pst)) {
+        metric_inc(C_PARAM_REUSED);
+        e->dir_dev = st.st_dev; e->dir_ino = st.st_ino;
+        time_t now = time(NULL);
+        if (difftime(now, e->last_seen) > 24 * 3600) { e->last_seen = now; index_dirty = true; }
+        return e;
+    }
+
+    struct ParamInfo info;
+    if (!have_param || !get_game_info(full_path, &info)) {
+        if (e) { cache_remove(full_path); index_dirty = true; }
+        neg_cache_add(full_path, &st);
+        return NULL;
+    }
+
+    log_debug("  [PARAM] %s: %s (%s v%s)", info.title_id, info.title_name, info.content_id, info.version);
+    e = cache_insert(full_path, info.title_id, info.title_name); if (!e) return NULL;
+    e->drm_state = DRM_UNCHECKED; // New fingerprint: migrated again once the dump settles
+    e->dev = pst.st_dev; e->ino = pst.st_ino; e->mtime = pst.st_mtime; e->size = pst.st_size;
+    e->dir_dev = st.st_dev; e->dir_ino = st.st_ino;
+    e->last_seen = time(NULL);
+    index_dirty = true;
+    return e;
 }
 
 // --- COUNTING ---
 int count_new_candidates() {
     int count = 0;
-    for (int i = 0; SCAN_PATHS[i] != NULL; i++) {
-        DIR* d = opendir(SCAN_PATHS[i]); if (!d) continue; 
+    devices_refresh();
+    for (int i = 0; i < MAX_ROOTS; i++) {
+        if (!roots[i].active) continue;
+        DIR* d = opendir(roots[i].path); if (!d) continue; 
         struct dirent* entry;
         while ((entry = readdir(d)) != NULL) { 
             if (entry->d_name[0] == '.') continue; 
-            char full_path[MAX_PATH]; snprintf(full_path, sizeof(full_path), "%s/%s", SCAN_PATHS[i], entry->d_name); 
-
-            char title_id[MAX_TITLE_ID]; char title_name[MAX_TITLE_NAME];
-            if (!get_game_info(full_path, title_id, title_name)) continue; 
-            if (is_installed(title_id) && is_data_mounted(title_id)) continue; 
+            char full_path[MAX_PATH]; if (!path_fmt(full_path, sizeof(full_path), "%s/%s", roots[i].path, entry->d_name)) continue;
 
-            bool already_seen = false;
-            for(int k=0; k<MAX_PENDING; k++) {
-                if (cache[k].valid && strcmp(cache[k].path, full_path) == 0) { already_seen = true; break; }
-            }
-            if (already_seen) continue;
+            struct GameCache* game = probe_game(full_path);
+            if (!game || game->seen) continue;
+            if (is_installed(game->title_id) && is_data_mounted(game->title_id)) continue; 
 
             count++;
         }
@@ -250,132 +1979,890 @@ int count_new_candidates() {
     return count;
 }
 
-bool mount_and_install(const char* src_path, const char* title_id, const char* title_name, bool is_remount) {
-    char system_ex_app[MAX_PATH]; char user_app_dir[MAX_PATH]; char user_sce_sys[MAX_PATH]; char src_sce_sys[MAX_PATH];
-    
-    // MOUNT
+// /system_ex is remounted writable at most once per scan cycle (system_ex_rw is cleared by
+// scan_all_paths()), and again only if a mount is refused with a permission error.
+bool system_ex_rw;
+
+static bool ensure_system_ex_rw(void) {
+    if (system_ex_rw) return true;
+    metric_inc(C_SYSEX_REMOUNTS);
+    TRACE_SCOPE("remount_system_ex", NULL);
+    if (plat_remount_system_ex() < 0) { log_debug("  [MOUNT] system_ex remount FAIL: %s", strerror(errno)); return false; }
+    system_ex_rw = true;
+    return true;
+}
+
+static bool is_perm_error(int err) { return err == EPERM || err == EACCES || err == EROFS; }
+
+bool mount_title(const char* src_path, const char* title_id) {
+    TRACE_SCOPE("mount", title_id);
+    char system_ex_app[MAX_PATH];
     snprintf(system_ex_app, sizeof(system_ex_app), "/system_ex/app/%s", title_id); 
-    mkdir(system_ex_app, 0777); remount_system_ex(); unmount(system_ex_app, 0); 
-    if (mount_nullfs(src_path, system_ex_app) < 0) { log_debug("  [MOUNT] FAIL: %s", strerror(errno)); return false; }
+    metric_inc(C_MOUNTS);
+    double t0 = now_ms();
+    ensure_system_ex_rw();
+    for (int attempt = 0; ; attempt++) {
+        mkdir(system_ex_app, 0777); plat_unmount(system_ex_app, false); 
+        if (plat_mount_nullfs(src_path, system_ex_app) == 0) { hist_since(H_MOUNT, t0); return true; }
+        int err = errno;
+        if (attempt == 0 && is_perm_error(err)) {
+            // The remount may have been undone behind our back; redo it once
+            system_ex_rw = false; metric_inc(C_SYSEX_REDONE);
+            if (ensure_system_ex_rw()) continue;
+        }
+        log_debug("  [MOUNT] FAIL: %s", strerror(err));
+        metric_inc(C_MOUNT_FAILURES);
+        errno = err; return false;
+    }
+}
 
-    // COPY FILES
+// COPY stage: assets into /user/app/<id>. Skipped for remounts.
+void copy_assets(const char* src_path, const char* title_id, bool is_remount) {
+    TRACE_SCOPE("copy", title_id);
+    char user_app_dir[MAX_PATH]; char user_sce_sys[MAX_PATH]; char src_sce_sys[MAX_PATH];
     if (!is_remount) {
         snprintf(user_app_dir, sizeof(user_app_dir), "/user/app/%s", title_id); 
-        snprintf(user_sce_sys, sizeof(user_sce_sys), "%s/sce_sys", user_app_dir);
+        snprintf(user_sce_sys, sizeof(user_sce_sys), "/user/app/%s/sce_sys", title_id);
         mkdir(user_app_dir, 0777); 
         mkdir(user_sce_sys, 0777);
 
+        struct CopyStats cs; memset(&cs, 0, sizeof(cs)); double t0 = now_ms();
         snprintf(src_sce_sys, sizeof(src_sce_sys), "%s/sce_sys", src_path); 
-        copy_dir(src_sce_sys, user_sce_sys); 
+        copy_dir(src_sce_sys, user_sce_sys, &cs); 
         
         char icon_src[MAX_PATH], icon_dst[MAX_PATH]; 
         snprintf(icon_src, sizeof(icon_src), "%s/sce_sys/icon0.png", src_path);
         snprintf(icon_dst, sizeof(icon_dst), "/user/app/%s/icon0.png", title_id); 
-        copy_file(icon_src, icon_dst);
+        if (access(icon_src, F_OK) == 0 || errno != ENOENT) copy_file(icon_src, icon_dst, &cs); // Not every dump has an icon
+
+        double ms = now_ms() - t0;
+        log_debug("  [COPY] %s: %u files, %.1f MB in %.0f ms (%.1f MB/s); %u unchanged, %.1f MB skipped%s", title_id, cs.files, cs.bytes / 1048576.0, ms,
+                  ms > 0 ? cs.bytes / 1048576.0 / (ms / 1000.0) : 0.0, cs.skipped, cs.skipped_bytes / 1048576.0, cs.errors ? "; with errors" : "");
+        metric_add(C_COPY_FILES, cs.files); metric_add(C_COPY_BYTES, cs.bytes); metric_add(C_COPY_ERRORS, cs.errors);
+        metric_add(C_COPY_SKIPPED_FILES, cs.skipped); metric_add(C_COPY_SKIPPED_BYTES, cs.skipped_bytes);
+        if (cs.bytes && ms > 0) hist_record(H_COPY_RATE, (uint64_t)(cs.bytes / 1024.0 / (ms / 1000.0)));  // All-skipped copies say nothing about speed
     } else {
-        log_debug("  [SPEED] Skipping file copy (Assets already exist)");
+        log_debug("  [SPEED] %s: Skipping file copy (Assets already exist)", title_id);
+    }
+}
+
+// Waits until the system has created /user/appmeta/<id> for a registered title, polling
+// with exponential backoff. Gives up after REG_WAIT_MAX_MS, the old fixed sleep.
+static bool wait_registered(const char* title_id) {
+    char meta[MAX_PATH]; snprintf(meta, sizeof(meta), "/user/appmeta/%s", title_id);
+    struct stat st; double start = now_ms();
+    for (unsigned wait = REG_POLL_MIN_MS; ; wait = wait * 2 > REG_POLL_MAX_MS ? REG_POLL_MAX_MS : wait * 2) {
+        if (stat(meta, &st) == 0) return true;
+        double left = REG_WAIT_MAX_MS - (now_ms() - start);
+        if (left <= 0) return false;
+        plat_sleep_us((unsigned)((wait < left ? wait : left) * 1000));
     }
+}
 
+// REGISTER stage: writes the tracker and registers the title. Returns the AppInstUtil result.
+int register_title(const char* src_path, const char* title_id) {
+    TRACE_SCOPE("register", title_id);
     // WRITE TRACKER
     char lnk_path[MAX_PATH]; snprintf(lnk_path, sizeof(lnk_path), "/user/app/%s/mount.lnk", title_id);
     FILE* flnk = fopen(lnk_path, "w"); if (flnk) { fprintf(flnk, "%s", src_path); fclose(flnk); }
     
     // REGISTER
-    int res = sceAppInstUtilAppInstallTitleDir(title_id, "/user/app/", 0);
-    sceKernelUsleep(200000); 
+    metric_inc(C_REGISTRATIONS);
+    double t0 = now_ms();
+    int res = plat_install_title(title_id, "/user/app/");
+    if ((res == 0 || res == (int)0x80990002) && !wait_registered(title_id))
+        log_debug("  [REG] %s: no appmeta after %d ms", title_id, REG_WAIT_MAX_MS);
+    hist_since(H_REGISTER, t0);
+    if (res != 0 && res != (int)0x80990002) metric_inc(C_REGISTER_FAILURES);
+    return res;
+}
+
+static void set_install_state(struct GameCache* game, uint8_t state) {
+    if (game->install_state != state) { game->install_state = state; index_dirty = true; }
+}
 
-    if (res == 0) { 
-        log_debug("  [REG] Installed NEW!"); 
-        trigger_rich_toast(title_id, title_name, "Installed"); 
+static void set_stage(struct GameCache* game, uint8_t stage) {
+    if (stage != CAND_SETTLING) walk_free(game);
+    game->stage = stage; game->stage_at = now_ms();
+    if (stage == CAND_DISCOVERED) game->discovered_at = game->stage_at;
+}
+
+// --- RETRIES ---
+// A failed mount or registration parks the title in the timer wheel and retries it with
+// capped exponential backoff, so transient failures recover without a replug or restart
+// and without adding work to every scan. The first matching policy wins; code 0 matches
+// any code of that kind. Mounts are keyed by errno, registrations by AppInstUtil result.
+// The only AppInstUtil result with a documented meaning is 0x80990002 (already installed),
+// which counts as success, so registration failures share the catch-all until other codes
+// are verified; each retry logs the code.
+enum { FAIL_MOUNT, FAIL_REGISTER };
+struct RetryPolicy { uint8_t kind; int code; uint8_t max_tries; uint32_t base_ms, cap_ms; };
+const struct RetryPolicy RETRY_POLICIES[] = {
+    { FAIL_MOUNT,    ENOENT, 0, 0,    0      },  // Source gone: wait for rediscovery
+    { FAIL_MOUNT,    EBUSY,  6, 1000, 30000  },  // Old mount still being torn down
+    { FAIL_MOUNT,    0,      3, 5000, 60000  },
+    { FAIL_REGISTER, 0,      5, 2000, 300000 },  // Any AppInstUtil error
+};
+
+static const struct RetryPolicy* retry_policy(uint8_t kind, int code) {
+    for (size_t k = 0; k < sizeof(RETRY_POLICIES) / sizeof(RETRY_POLICIES[0]); k++) {
+        const struct RetryPolicy* p = &RETRY_POLICIES[k];
+        if (p->kind == kind && (p->code == 0 || p->code == code)) return p;
     }
-    else if (res == 0x80990002) { 
-        log_debug("  [REG] Restored."); 
-        // Silent on restore/remount to avoid spam
+    return NULL;
+}
+
+// Schedules another install attempt, or marks the title failed once its policy is used
+// up. Returns true if a retry was scheduled.
+bool retry_schedule(struct GameCache* game, uint8_t kind, int code) {
+    const struct RetryPolicy* p = retry_policy(kind, code);
+    set_install_state(game, INST_FAILED); // Also keeps a mounted but unregistered title from looking done
+    if (!p || game->retries >= p->max_tries) {
+        if (p && p->max_tries) log_debug("  [RETRY] %s: giving up after %u attempt(s)", game->title_id, game->retries + 1);
+        set_stage(game, CAND_DONE);
+        return false;
     }
-    else { log_debug("  [REG] FAIL: 0x%x", res); return false; }
+    game->retries++; metric_inc(C_RETRIES);
+    uint64_t delay = (uint64_t)p->base_ms << (game->retries - 1);
+    if (delay > p->cap_ms) delay = p->cap_ms;
+    log_debug("  [RETRY] %s: %s error 0x%x, attempt %u/%u in %.0f s", game->title_id, kind == FAIL_MOUNT ? "mount" : "register",
+              code, game->retries + 1, p->max_tries + 1, delay / 1000.0);
+    set_stage(game, CAND_RETRY_WAIT); // Settled already; relists leave it alone until the timer fires
+    game->seen = false; wheel_schedule(game, (double)delay);
     return true;
 }
 
-void scan_all_paths() {
-    
-    // Cache Cleaner
-    for(int k=0; k<MAX_PENDING; k++) {
-        if (cache[k].valid) {
-            if (access(cache[k].path, F_OK) != 0) {
-                cache[k].valid = false;
-            }
+// --- INSTALL PIPELINE ---
+// discover -> parse -> settle -> mount run on the main loop: they only touch metadata and
+// the cache, and are cheap once fingerprints are warm. copy and register are I/O bound and
+// run on their own threads behind bounded queues, so a slow copy or registration never
+// holds up the readdir loop:
+//   copy:     INSTALL_WORKERS threads. Jobs are grouped into lanes by source device and each
+//             lane has its own concurrency limit, so the internal SSD and several USB drives
+//             drain side by side without piling seeks onto one disk.
+//   register: one thread. AppInstUtil is not known to be reentrant.
+// Workers only touch their job; results are applied to the cache by install_reap() on the
+// main thread.
+#define QUEUE_MAX       64      // Per stage; a full copy queue defers new titles via the wheel
+#define LANE_INTERNAL   MAX_DEVICES
+#define LANE_COUNT      (MAX_DEVICES + 1)
+// Stage latencies for the [PIPE] report, in pipeline order
+const struct { const char* name; int hist; } PIPE_STAGES[] = {
+    { "discover", H_DISCOVER }, { "parse", H_PARSE }, { "settle", H_SETTLE },
+    { "mount", H_MOUNT }, { "copy", H_COPY }, { "register", H_REGISTER }, { NULL, 0 }
+};
+
+struct InstallJob {
+    char path[MAX_PATH];
+    char title_id[MAX_TITLE_ID];
+    char title_name[MAX_TITLE_NAME];
+    bool is_remount;
+    int lane;
+    double changed_at, queued_at;   // queued_at: entered the current stage's queue
+    int res;
+    struct InstallJob* next;
+};
+struct JobQueue { struct InstallJob *head, *tail; int len, high; };
+
+pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t copy_ready = PTHREAD_COND_INITIALIZER;  // Copy job queued or a lane freed up
+pthread_cond_t reg_ready = PTHREAD_COND_INITIALIZER;   // Register job queued
+pthread_cond_t reg_space = PTHREAD_COND_INITIALIZER;   // Register queue drained below QUEUE_MAX
+pthread_cond_t job_idle = PTHREAD_COND_INITIALIZER;    // A job finished
+struct JobQueue copy_q, reg_q;
+struct InstallJob* job_done;
+int lane_running[LANE_COUNT];
+int jobs_in_flight;              // Anywhere between mount and reap
+int copy_workers;
+bool reg_worker;
+
+void stage_report(void) {
+    char line[512]; size_t o = 0;
+    for (int k = 0; PIPE_STAGES[k].name && o < sizeof(line); k++) {
+        const struct Histogram* hg = &hists[PIPE_STAGES[k].hist];
+        o += (size_t)snprintf(line + o, sizeof(line) - o, "%s%s %llu p50 %.1f p90 %.1f max %.1f", k ? " | " : "", PIPE_STAGES[k].name,
+                              (unsigned long long)hg->count, hist_quantile(hg, 0.50) / 1000.0, hist_quantile(hg, 0.90) / 1000.0, hg->max / 1000.0);
+    }
+    log_debug("[PIPE] ms: %s (queue high copy %d, register %d)", line, copy_q.high, reg_q.high);
+    uint64_t mounts = metric_get(C_MOUNTS), remounts = metric_get(C_SYSEX_REMOUNTS);
+    log_debug("[PIPE] system_ex: %llu remount(s) for %llu mount(s), %llu saved, %llu redone after a permission error",
+              (unsigned long long)remounts, (unsigned long long)mounts, (unsigned long long)(mounts > remounts ? mounts - remounts : 0),
+              (unsigned long long)metric_get(C_SYSEX_REDONE));
+    metrics_save();
+    trace_export();
+}
+
+static void queue_push(struct JobQueue* q, struct InstallJob* j) {
+    j->next = NULL; j->queued_at = now_ms();
+    if (q->tail) q->tail->next = j; else q->head = j;
+    q->tail = j;
+    if (++q->len > q->high) q->high = q->len;
+}
+
+static void queue_unlink(struct JobQueue* q, struct InstallJob** pp, struct InstallJob* prev) {
+    struct InstallJob* j = *pp;
+    *pp = j->next;
+    if (q->tail == j) q->tail = prev;
+    q->len--;
+}
+
+static int lane_limit(int lane) { return lane == LANE_INTERNAL ? JOBS_PER_INTERNAL : JOBS_PER_DEVICE; }
+
+static int lane_of_root(int root) {
+    return root < INTERNAL_ROOT_COUNT ? LANE_INTERNAL : (root - INTERNAL_ROOT_COUNT) / DEVICE_SUBDIR_COUNT;
+}
+
+// Called with job_lock held: first queued copy whose lane has room
+static struct InstallJob* copy_take(void) {
+    struct InstallJob* prev = NULL;
+    for (struct InstallJob** pp = &copy_q.head; *pp; prev = *pp, pp = &(*pp)->next) {
+        struct InstallJob* j = *pp;
+        if (lane_running[j->lane] < lane_limit(j->lane)) { queue_unlink(&copy_q, pp, prev); lane_running[j->lane]++; return j; }
+    }
+    return NULL;
+}
+
+static void job_finish(struct InstallJob* j) {
+    pthread_mutex_lock(&job_lock);
+    jobs_in_flight--;
+    j->next = job_done; job_done = j;
+    pthread_cond_broadcast(&job_idle);
+    pthread_mutex_unlock(&job_lock);
+    if (wake_pipe[1] >= 0) { char c = 1; (void)!write(wake_pipe[1], &c, 1); }
+}
+
+static void* copy_worker(void* arg) {
+    (void)arg;
+    for (;;) {
+        pthread_mutex_lock(&job_lock);
+        struct InstallJob* j;
+        while ((j = copy_take()) == NULL) pthread_cond_wait(&copy_ready, &job_lock);
+        pthread_mutex_unlock(&job_lock);
+
+        copy_assets(j->path, j->title_id, j->is_remount);
+        hist_since(H_COPY, j->queued_at);
+
+        pthread_mutex_lock(&job_lock);
+        lane_running[j->lane]--;
+        pthread_cond_broadcast(&copy_ready);
+        while (reg_q.len >= QUEUE_MAX) pthread_cond_wait(&reg_space, &job_lock); // Backpressure
+        queue_push(&reg_q, j);
+        pthread_cond_signal(&reg_ready);
+        pthread_mutex_unlock(&job_lock);
+    }
+    return NULL;
+}
+
+static void* register_worker(void* arg) {
+    (void)arg;
+    for (;;) {
+        pthread_mutex_lock(&job_lock);
+        while (!reg_q.head) pthread_cond_wait(&reg_ready, &job_lock);
+        struct InstallJob* j = reg_q.head;
+        queue_unlink(&reg_q, &reg_q.head, NULL);
+        pthread_cond_signal(&reg_space);
+        pthread_mutex_unlock(&job_lock);
+
+        j->res = register_title(j->path, j->title_id);
+        job_finish(j);
+    }
+    return NULL;
+}
+
+static void install_start(void) {
+    if (pipe(wake_pipe) == 0) {
+        fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK); fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+    } else wake_pipe[0] = wake_pipe[1] = -1;
+    pthread_t t;
+    if (pthread_create(&t, NULL, register_worker, NULL) == 0) { pthread_detach(t); reg_worker = true; }
+    for (int k = 0; reg_worker && k < INSTALL_WORKERS; k++) {
+        if (pthread_create(&t, NULL, copy_worker, NULL) != 0) break;
+        pthread_detach(t); copy_workers++;
+    }
+    if (copy_workers < INSTALL_WORKERS) log_debug("[INSTALL] Only %d of %d copy workers started%s", copy_workers, INSTALL_WORKERS,
+                                                  copy_workers ? "" : ", installing inline");
+}
+
+// True if the copy stage can take another title
+bool install_has_room(void) {
+    pthread_mutex_lock(&job_lock);
+    bool room = copy_q.len < QUEUE_MAX;
+    pthread_mutex_unlock(&job_lock);
+    return room;
+}
+
+// Hands a mounted title to the copy stage, or runs copy and register inline if the
+// workers could not be started. Returns false if the job could not be allocated.
+static bool install_submit(const struct GameCache* game, bool is_remount) {
+    struct InstallJob* j = (struct InstallJob*)calloc(1, sizeof(*j));
+    if (!j) return false;
+    strcpy(j->path, game->path); strcpy(j->title_id, game->title_id); strcpy(j->title_name, game->title_name);
+    j->is_remount = is_remount; j->lane = lane_of_root(game->root); j->changed_at = game->changed_at;
+
+    pthread_mutex_lock(&job_lock);
+    jobs_in_flight++;
+    if (copy_workers > 0) {
+        queue_push(&copy_q, j);
+        pthread_cond_broadcast(&copy_ready);
+        pthread_mutex_unlock(&job_lock);
+        return true;
+    }
+    pthread_mutex_unlock(&job_lock);
+    double t0 = now_ms();
+    copy_assets(j->path, j->title_id, j->is_remount);
+    hist_since(H_COPY, t0);
+    j->res = register_title(j->path, j->title_id);
+    job_finish(j);
+    return true;
+}
+
+// Applies finished jobs to the cache. Main thread only. Returns the number applied.
+int install_reap(void) {
+    if (wake_pipe[0] >= 0) { char buf[64]; while (read(wake_pipe[0], buf, sizeof(buf)) > 0) {} }
+    pthread_mutex_lock(&job_lock);
+    struct InstallJob* list = job_done; job_done = NULL;
+    bool idle = jobs_in_flight == 0;
+    pthread_mutex_unlock(&job_lock);
+
+    int n = 0;
+    for (struct InstallJob* j = list, *next; j; j = next, n++) {
+        next = j->next;
+        bool ok = true;
+        if (j->res == 0) { 
+            log_debug("  [REG] %s Installed NEW!", j->title_id); 
+            trigger_rich_toast(j->title_id, j->title_name, "Installed"); 
+        }
+        else if (j->res == (int)0x80990002) { 
+            log_debug("  [REG] %s Restored.", j->title_id); 
+            // Silent on restore/remount to avoid spam
+        }
+        else { log_debug("  [REG] %s FAIL: 0x%x", j->title_id, j->res); ok = false; }
+
+        struct GameCache* game = cache_find(j->path);
+        if (game && game->stage == CAND_INSTALLING) {
+            if (ok) {
+                set_install_state(game, INST_MOUNTED);
+                set_stage(game, CAND_DONE);
+                game->retries = 0;
+            } else retry_schedule(game, FAIL_REGISTER, j->res);
+        }
+        if (ok) log_debug("  [WATCH] %s mounted %.0f ms after change", j->title_id, now_ms() - j->changed_at);
+        free(j);
+    }
+    if (n > 0 && idle) stage_report(); // End of a batch
+    return n;
+}
+
+// Blocks until every queued install has finished, then applies the results.
+void install_drain(void) {
+    pthread_mutex_lock(&job_lock);
+    while (jobs_in_flight > 0) pthread_cond_wait(&job_idle, &job_lock);
+    pthread_mutex_unlock(&job_lock);
+    install_reap();
+}
+
+// Handles one candidate directory found under root `i`. Drives the title through
+// discovered -> settling -> stable -> installing -> done.
+// Returns true once the dump has settled. Unsettled dumps are rechecked from the timer wheel.
+static bool settle_title(struct GameCache* game, const char* full_path) {
+    if (game->stage == CAND_STABLE || game->stage == CAND_RETRY_WAIT) return true; // Settled, was waiting for queue room or a retry
+    // FAST CHECK: unsettled titles are rechecked from the timer wheel
+    double delay = stability_delay_ms(game, full_path, game->title_name);
+    if (delay > 0) {
+        if (game->stage != CAND_SETTLING) set_stage(game, CAND_SETTLING);
+        game->seen = false; wheel_schedule(game, delay);
+        return false;
+    }
+    if (game->stage == CAND_SETTLING) log_debug("  [WAIT] %s settled after %.1fs", game->title_name, (now_ms() - game->discovered_at) / 1000.0);
+    hist_since(H_SETTLE, game->discovered_at);
+    set_stage(game, CAND_STABLE);
+    return true;
+}
+
+// Runs the applicationDrmType migration once per settled dump. Returns false if param.json
+// moved after settling; the title then settles again.
+static bool migrate_title(struct GameCache* game) {
+    if (game->drm_state != DRM_UNCHECKED) return true;
+    game->drm_state = migrate_drm_type(game);
+    if (game->drm_state != DRM_UNCHECKED) return true;
+    log_debug("  [DRM] %s: param.json changed, waiting", game->title_id);
+    set_stage(game, CAND_SETTLING);
+    game->seen = false; wheel_schedule(game, SETTLE_RECHECK_MS);
+    return false;
+}
+
+static void process_entry(int i, const char* full_path, double changed_at) {
+    struct GameCache* game = cache_find(full_path);
+    if (game && game->stage == CAND_INSTALLING) return; // Job still in flight
+    if (game && game->stage == CAND_RETRY_WAIT && game->scheduled) return; // Backing off: a relist must not retry early
+    if (game) wheel_cancel(game);
+
+    game = probe_game(full_path);
+    if (!game) return;
+    game->seen = true; game->root = (int8_t)i; game->listed_gen = neg_gen;
+    if (game->stage != CAND_SETTLING && game->stage != CAND_STABLE && game->stage != CAND_RETRY_WAIT) {
+        set_stage(game, CAND_DISCOVERED);
+        game->changed_at = changed_at;
+        hist_since(H_DISCOVER, changed_at);
+        game->retries = 0;
+    }
+    const char* title_id = game->title_id; const char* title_name = game->title_name;
+
+    // 1. Skip if perfect (a failed registration leaves it mounted, so that is retried too)
+    bool installed = is_installed(title_id);
+    if (installed && is_data_mounted(title_id) && game->install_state != INST_FAILED) {
+        const char* src = mnt_valid ? mount_source(title_id) : full_path;
+        struct GameCache* owner = mount_src_is(src, full_path) ? game : cache_find(src);
+        if (owner && !mount_current(owner, src)) { log_debug("  [MOUNT] %s: mount of %s is stale", title_id, src); owner = NULL; }
+        if (owner && (owner == game || owner->seen)) {
+            if (owner != game) log_debug("  [MOUNT] %s: keeping %s, duplicate at %s", title_id, src, full_path);
+            else if (game->drm_state == DRM_UNCHECKED && (!settle_title(game, full_path) || !migrate_title(game))) return; // New dump under the mount
+            set_install_state(game, INST_MOUNTED);
+            set_stage(game, CAND_DONE);
+            return; 
+        }
+        log_debug("  [MOUNT] %s is mounted from %s, remounting from %s", title_id, src, full_path);
+    }
+
+    // 2. Decide Action
+    bool is_remount = false;
+    if (installed) {
+        log_debug("  [ACTION] Remounting: %s", title_name);
+        // NOTIFICATION REMOVED FOR REMOUNT
+        is_remount = true;
+        // A dump not migrated yet may be an update copied over the title or another dump under its ID
+        if (game->drm_state == DRM_UNCHECKED && !settle_title(game, full_path)) return;
+    } else {
+        if (game->stage == CAND_DISCOVERED) {
+            log_debug("  [ACTION] Installing: %s", title_name);
+            notify_system("Installing: %s...", title_name); 
+        }
+        if (!settle_title(game, full_path)) return;
+        is_remount = false;
+    }
+
+    if (!install_has_room()) {
+        log_debug("  [INSTALL] Copy queue full, deferring %s", title_id);
+        set_stage(game, CAND_STABLE);
+        game->seen = false; wheel_schedule(game, SETTLE_RECHECK_MS);
+        return;
+    }
+    if (!migrate_title(game)) return;
+    set_stage(game, CAND_INSTALLING);
+    bool mounted = mount_title(full_path, title_id);
+    int mount_err = errno;
+    if (!mounted) { retry_schedule(game, FAIL_MOUNT, mount_err); return; }
+    mount_note(title_id, full_path, 0);
+    game->mnt_dev = game->dir_dev; game->mnt_ino = game->dir_ino; index_dirty = true;
+    if (!install_submit(game, is_remount)) {
+        log_debug("  [INSTALL] Out of memory, retrying %s", title_id);
+        set_stage(game, CAND_STABLE);
+        game->seen = false; wheel_schedule(game, SETTLE_RECHECK_MS);
+    }
+}
+
+// --- PENDING FOLDERS ---
+// Folders under a root that did not probe as a game yet, e.g. eboot.bin copied before
+// sce_sys/param.json. Files arriving inside them leave the root's listing unchanged, so each
+// is probed again every SETTLE_RECHECK_MS until it becomes a game, disappears, or neither it
+// nor anything directly inside it was written for SETTLE_SECS.
+struct PendingDir { char path[MAX_PATH]; int8_t root; double changed_at; };
+struct PendingDir* pending;
+size_t pending_count, pending_cap;
+double pending_due;     // now_ms() of the next recheck
+
+double pending_next_due_ms(void) {
+    if (!pending_count) return -1;
+    double ms = pending_due - now_ms();
+    return ms > 0 ? ms : 0;
+}
+
+// Newest mtime of `path` and its direct entries, -1 if it is gone
+static time_t pending_newest(const char* path) {
+    struct stat st; metric_inc(C_STAT_CALLS);
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) return -1;
+    time_t newest = st.st_mtime;
+    DIR* d = opendir(path); if (!d) return newest;
+    struct dirent* e;
+    while ((e = readdir(d)) != NULL) {
+        if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+        char child[MAX_PATH]; if (!path_fmt(child, sizeof(child), "%s/%s", path, e->d_name)) continue;
+        metric_inc(C_STAT_CALLS);
+        if (lstat(child, &st) == 0 && st.st_mtime > newest) newest = st.st_mtime;
+    }
+    closedir(d);
+    return newest;
+}
+
+// Called for a listed entry that is not a game. Only folders written to recently are kept.
+static void pending_note(int i, const char* path, double changed_at) {
+    struct stat st; metric_inc(C_STAT_CALLS);
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode) || difftime(time(NULL), st.st_mtime) > SETTLE_SECS) return;
+    for (size_t k = 0; k < pending_count; k++) if (!strcmp(pending[k].path, path)) return;
+    if (pending_count == pending_cap) {
+        size_t cap = pending_cap ? pending_cap * 2 : 16;
+        struct PendingDir* np = (struct PendingDir*)realloc(pending, cap * sizeof(*np)); if (!np) return;
+        pending = np; pending_cap = cap;
+    }
+    struct PendingDir* p = &pending[pending_count];
+    strncpy(p->path, path, MAX_PATH - 1); p->path[MAX_PATH - 1] = '\0';
+    p->root = (int8_t)i; p->changed_at = changed_at;
+    if (!pending_count++) pending_due = now_ms() + SETTLE_RECHECK_MS;
+    log_debug("  [PENDING] %s: not a game yet, rechecking", path);
+}
+
+static void pending_drop(size_t k) { pending[k] = pending[--pending_count]; }
+
+// Probes every pending folder once it is due. Titles found move on through process_entry().
+static void pending_recheck(void) {
+    if (!pending_count || now_ms() < pending_due) return;
+    for (size_t k = pending_count; k-- > 0; ) {
+        struct PendingDir* p = &pending[k];
+        if (p->root < 0 || !roots[p->root].active) { pending_drop(k); continue; }
+        time_t newest = pending_newest(p->path);
+        if (newest < 0) { pending_drop(k); continue; }
+        struct GameCache* game = cache_find(p->path);
+        if (!game || !game->seen) process_entry(p->root, p->path, p->changed_at);
+        if (cache_find(p->path)) {
+            log_debug("  [PENDING] %s: now a game", p->path);
+            pending_drop(k);
+        } else if (difftime(time(NULL), newest) > SETTLE_SECS) {
+            log_debug("  [PENDING] %s: unchanged for %ds, not a game", p->path, SETTLE_SECS);
+            pending_drop(k);
         }
     }
+    pending_due = now_ms() + SETTLE_RECHECK_MS;
+}
+
+void scan_all_paths() {
+    TRACE_SCOPE("scan", NULL);
+    metric_inc(C_SCAN_CYCLES);
+    double t0 = now_ms();
+    neg_gen++;
+    walk_budget = WALK_BUDGET;
+    drm_rewrites = 0;
+    system_ex_rw = false; // Remounted lazily by the first mount of this cycle
+    int finished = install_reap();
+    
+    devices_refresh();
+    watcher_sync();
+    int scanned = 0, active = 0;
+    for (int i = 0; i < MAX_ROOTS; i++) { active += roots[i].active; scanned += roots[i].active && roots[i].dirty; }
 
-    for (int i = 0; SCAN_PATHS[i] != NULL; i++) {
-        DIR* d = opendir(SCAN_PATHS[i]); if (!d) continue; 
+    // Titles whose settle timer expired, regardless of whether their root changed
+    static struct GameCache* due[64]; static char due_path[64][MAX_PATH]; static int due_root[64];
+    size_t n_due = wheel_expire(due, 64);
+    for (size_t k = 0; k < n_due; k++) { strcpy(due_path[k], due[k]->path); due_root[k] = due[k]->root; }
+    bool pending_ready = pending_count && now_ms() >= pending_due;
+    if (scanned == 0 && n_due == 0 && finished == 0 && !pending_ready) return;
+
+    bool relisted[MAX_ROOTS] = { false };
+    for (int i = 0; i < MAX_ROOTS; i++) {
+        if (!roots[i].active) continue;
+        if (!roots[i].dirty) continue;
+        TRACE_SCOPE("readdir", roots[i].path);
+        double changed_at = roots[i].dirty_at;
+        root_listed(i); relisted[i] = true;
+        DIR* d = opendir(roots[i].path); if (!d) continue; 
+        metric_inc(C_ROOTS_LISTED);
         
         struct dirent* entry;
         while ((entry = readdir(d)) != NULL) { 
+            metric_inc(C_DIR_ENTRIES);
 
             if (entry->d_name[0] == '.') continue; 
-            char full_path[MAX_PATH]; snprintf(full_path, sizeof(full_path), "%s/%s", SCAN_PATHS[i], entry->d_name); 
+            char full_path[MAX_PATH]; if (!path_fmt(full_path, sizeof(full_path), "%s/%s", roots[i].path, entry->d_name)) continue;
             
-            bool already_seen = false;
-            for(int k=0; k<MAX_PENDING; k++) {
-                if (cache[k].valid && strcmp(cache[k].path, full_path) == 0) { already_seen = true; break; }
-            }
-            if (already_seen) continue; 
-
-            char title_id[MAX_TITLE_ID]; char title_name[MAX_TITLE_NAME];
-            if (get_game_info(full_path, title_id, title_name)) {
-                for(int k=0; k<MAX_PENDING; k++) {
-                    if (!cache[k].valid) {
-                        strncpy(cache[k].path, full_path, MAX_PATH);
-                        strncpy(cache[k].title_id, title_id, MAX_TITLE_ID);
-                        strncpy(cache[k].title_name, title_name, MAX_TITLE_NAME);
-                        cache[k].valid = true;
-                        break;
-                    }
-                }
-            } else { continue; }
+            struct GameCache* game = cache_find(full_path);
+            if (game && game->seen) { game->listed_gen = neg_gen; continue; }
 
-            // 1. Skip if perfect
-            bool installed = is_installed(title_id);
-            if (installed && is_data_mounted(title_id)) {
-                continue; 
-            }
+            process_entry(i, full_path, changed_at);
+            if (!cache_find(full_path)) pending_note(i, full_path, changed_at);
+        }
+        closedir(d);
+    }
 
-            // 2. Decide Action
-            bool is_remount = false;
-            if (installed) {
-                log_debug("  [ACTION] Remounting: %s", title_name);
-                // NOTIFICATION REMOVED FOR REMOUNT
-                is_remount = true;
-            } else {
-                log_debug("  [ACTION] Installing: %s", title_name);
-                notify_system("Installing: %s...", title_name); 
-                
-                // FAST CHECK
-                if (!wait_for_stability_fast(full_path, title_name)) continue;
-                is_remount = false;
-            }
+    // Cache Cleaner: forget handled titles that a relist of their root no longer showed, or
+    // whose device left the mount table; keep their metadata for the index
+    for (size_t k = 0; k < cache_cap; k++) {
+        struct GameCache* e = cache[k];
+        if (!CACHE_LIVE(e) || !e->seen) continue;
+        if (e->root < 0 || !roots[e->root].active || (relisted[e->root] && e->listed_gen != neg_gen)) e->seen = false;
+    }
 
-            mount_and_install(full_path, title_id, title_name, is_remount);
+    // Paths are copied first: a probe may drop the entry
+    for (size_t k = 0; k < n_due; k++) {
+        struct GameCache* game = cache_find(due_path[k]);
+        if (!game || game->seen || game->scheduled || due_root[k] < 0 || !roots[due_root[k]].active) continue;
+        process_entry(due_root[k], due_path[k], game->changed_at);
+    }
+    pending_recheck();
+
+    if (scanned == active) neg_cache_prune(); // Only a full pass proves an entry is gone
+    index_save();
+    if (drm_rewrites) log_debug("[DRM] %d param.json rewrite(s) this cycle", drm_rewrites);
+    metric_add(C_STAT_CALLS, (uint64_t)(WALK_BUDGET - (walk_budget > 0 ? walk_budget : 0)));
+    hist_since(H_SCAN, t0); // Working cycles only; idle wakeups would drown the distribution
+    metrics_tick();
+}
+
+// --- METRICS EXPOSITION ---
+// Prometheus text format. Histogram buckets are reported at 2^k - 1 recorded units (us, KB/s),
+// converted to the base unit (seconds, bytes/s), all of them on every export, empty or not, so every
+// snapshot has the same series; p50/p90/p99 from the full-resolution buckets ride along as
+// comments. Device gauges are computed from the cache at export time. Main thread only.
+static void metric_label(FILE* f, const char* v) {
+    for (; *v; v++) {
+        if (*v == '\\' || *v == '"') fputc('\\', f);
+        if (*v == '\n') fputs("\\n", f); else fputc(*v, f);
+    }
+}
+
+static void metrics_emit(FILE* f) {
+    for (int c = 0; c < C_COUNT; c++)
+        fprintf(f, "# HELP shadowmount_%s %s\n# TYPE shadowmount_%s counter\nshadowmount_%s %llu\n", COUNTER_INFO[c][0], COUNTER_INFO[c][1],
+                COUNTER_INFO[c][0], COUNTER_INFO[c][0], (unsigned long long)metric_get(c));
+
+    for (int h = 0; h < H_COUNT; h++) {
+        const struct Histogram* hg = &hists[h];
+        uint64_t count = atomic_load_explicit(&hg->count, memory_order_relaxed), max = atomic_load_explicit(&hg->max, memory_order_relaxed);
+        fprintf(f, "# HELP shadowmount_%s %s\n# TYPE shadowmount_%s histogram\n", hg->name, hg->help, hg->name);
+        if (count) fprintf(f, "# p50 %g p90 %g p99 %g max %g\n", hist_quantile(hg, 0.50) * hg->scale, hist_quantile(hg, 0.90) * hg->scale,
+                           hist_quantile(hg, 0.99) * hg->scale, max * hg->scale);
+        // Buckets up to the first one of an octave hold the values up to 2^octave - 1, which is
+        // the inclusive bound `le` asks for; the bucket holding 2^octave itself reaches past it.
+        // The last bucket also takes everything past the range, so its octave is left to +Inf.
+        uint64_t cum = 0; int i = 0;
+        for (int octave = 0; hist_index((1ull << octave) - 1) < HIST_BUCKETS - 1; octave++) {
+            for (; hist_upper(i) < (1ull << octave); i++) cum += atomic_load_explicit(&hg->b[i], memory_order_relaxed);
+            fprintf(f, "shadowmount_%s_bucket{le=\"%g\"} %llu\n", hg->name, (double)((1ull << octave) - 1) * hg->scale, (unsigned long long)cum);
         }
-        closedir(d);
+        fprintf(f, "shadowmount_%s_bucket{le=\"+Inf\"} %llu\n", hg->name, (unsigned long long)count);
+        fprintf(f, "shadowmount_%s_sum %g\nshadowmount_%s_count %llu\n", hg->name,
+                atomic_load_explicit(&hg->sum, memory_order_relaxed) * hg->scale, hg->name, (unsigned long long)count);
+    }
+
+    uint32_t titles[LANE_COUNT] = { 0 }, mounted[LANE_COUNT] = { 0 }, stages[CAND_DONE + 1] = { 0 };
+    for (size_t k = 0; k < cache_cap; k++) {
+        const struct GameCache* e = cache[k];
+        if (!CACHE_LIVE(e)) continue;
+        if (e->stage <= CAND_DONE) stages[e->stage]++;
+        if (e->root < 0 || !roots[e->root].active) continue;
+        int lane = lane_of_root(e->root);
+        titles[lane]++; mounted[lane] += e->install_state == INST_MOUNTED;
+    }
+    int running[LANE_COUNT];
+    pthread_mutex_lock(&job_lock);
+    memcpy(running, lane_running, sizeof(running));
+    int copy_len = copy_q.len, reg_len = reg_q.len;
+    pthread_mutex_unlock(&job_lock);
+
+    fputs("# HELP shadowmount_titles Known titles by candidate stage\n# TYPE shadowmount_titles gauge\n", f);
+    for (int k = 0; k <= CAND_DONE; k++) fprintf(f, "shadowmount_titles{stage=\"%s\"} %u\n", CAND_NAMES[k], stages[k]);
+    fputs("# HELP shadowmount_install_queue_depth Jobs waiting per install stage\n# TYPE shadowmount_install_queue_depth gauge\n", f);
+    fprintf(f, "shadowmount_install_queue_depth{stage=\"copy\"} %d\nshadowmount_install_queue_depth{stage=\"register\"} %d\n", copy_len, reg_len);
+
+    static const char* DEVICE_GAUGES[][2] = {
+        { "device_titles", "Titles found on the device" },
+        { "device_mounted_titles", "Titles from the device mounted into /system_ex/app" },
+        { "device_copies_running", "Asset copies running in the device's lane" },
+        { "device_free_bytes", "Free space on the device" },
+    };
+    for (int g = 0; g < 4; g++) {
+        fprintf(f, "# HELP shadowmount_%s %s\n# TYPE shadowmount_%s gauge\n", DEVICE_GAUGES[g][0], DEVICE_GAUGES[g][1], DEVICE_GAUGES[g][0]);
+        for (int lane = 0; lane < LANE_COUNT; lane++) {
+            bool internal = lane == LANE_INTERNAL;
+            if (!internal && !devices[lane].present) continue;
+            const char* mnt = internal ? "/data" : devices[lane].mnt;
+            uint64_t v;
+            if (g == 0) v = titles[lane];
+            else if (g == 1) v = mounted[lane];
+            else if (g == 2) v = (uint64_t)running[lane];
+            else { struct statvfs sv; if (statvfs(mnt, &sv) != 0) continue; v = (uint64_t)sv.f_bavail * sv.f_frsize; }
+            fprintf(f, "shadowmount_%s{device=\"", DEVICE_GAUGES[g][0]); metric_label(f, internal ? "internal" : mnt);
+            fputs("\",mount=\"", f); metric_label(f, mnt);
+            fputs("\",fstype=\"", f); metric_label(f, internal ? "" : devices[lane].fstype);
+            fprintf(f, "\"} %llu\n", (unsigned long long)v);
+        }
+    }
+}
+
+// `metrics` control command
+void metrics_write(int fd) {
+    int dfd = dup(fd); if (dfd < 0) return;
+    FILE* f = fdopen(dfd, "w"); if (!f) { close(dfd); return; }
+    metrics_emit(f);
+    fclose(f);
+}
+
+// Rewrites METRICS_FILE atomically, for scrapers that read files (node_exporter textfile etc.)
+double metrics_saved_at;
+void metrics_save(void) {
+    char tmp[MAX_PATH]; snprintf(tmp, sizeof(tmp), "%s.tmp", METRICS_FILE);
+    FILE* f = fopen(tmp, "w");
+    if (!f) { log_debug("[METRICS] %s: %s", tmp, strerror(errno)); return; }
+    metrics_emit(f);
+    if (fclose(f) != 0 || rename(tmp, METRICS_FILE) != 0) { log_debug("[METRICS] %s: %s", METRICS_FILE, strerror(errno)); remove(tmp); return; }
+    metrics_saved_at = now_ms();
+}
+
+// After a working scan cycle: refreshes the snapshot at most every METRICS_WRITE_SECS
+void metrics_tick(void) {
+    if (now_ms() - metrics_saved_at >= METRICS_WRITE_SECS * 1000.0) metrics_save();
+}
+
+// --- CONTROL ---
+// Local UNIX socket at CONTROL_SOCK, served from the main loop (its fd sits in the same
+// poll as the watchers). One command per connection, answered in plain text:
+//   status | rescan [path] | stop | dump-cache | metrics
+// e.g.  echo status | nc -U /data/shadowmount/control.sock
+bool ctl_stop;
+double started_at;
+
+void ctl_start(void) {
+    struct sockaddr_un addr; memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX; strncpy(addr.sun_path, CONTROL_SOCK, sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) { log_debug("[CTL] socket: %s", strerror(errno)); return; }
+    unlink(CONTROL_SOCK);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+        log_debug("[CTL] %s: %s", CONTROL_SOCK, strerror(errno)); close(fd); return;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK); fcntl(fd, F_SETFD, FD_CLOEXEC);
+    chmod(CONTROL_SOCK, 0666);
+    ctl_fd = fd;
+}
+
+static void ctl_printf(int fd, const char* fmt, ...) {
+    char buf[2048]; va_list args; va_start(args, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, args); va_end(args);
+    if (n > 0) write_all(fd, buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+}
+
+static void ctl_status(int fd) {
+    int active = 0, watched = 0, devs = 0;
+    for (int i = 0; i < MAX_ROOTS; i++) if (roots[i].active) { active++; watched += roots[i].wd >= 0; }
+    uint32_t stages[CAND_DONE + 1] = { 0 };
+    for (size_t k = 0; k < cache_cap; k++) if (CACHE_LIVE(cache[k]) && cache[k]->stage <= CAND_DONE) stages[cache[k]->stage]++;
+    pthread_mutex_lock(&job_lock);
+    int in_flight = jobs_in_flight, copy_len = copy_q.len, reg_len = reg_q.len;
+    pthread_mutex_unlock(&job_lock);
+    double due = wheel_next_due_ms();
+
+    ctl_printf(fd, "uptime %.0f s, %llu scan cycle(s)\n", (now_ms() - started_at) / 1000.0, (unsigned long long)metric_get(C_SCAN_CYCLES));
+    ctl_printf(fd, "roots %d active, %d watched; mount table %s\n", active, watched, mounts_watched ? "watched" : "polled");
+    for (int k = 0; k < MAX_DEVICES; k++) if (devices[k].present) { ctl_printf(fd, "device %s (%s)\n", devices[k].mnt, devices[k].fstype); devs++; }
+    ctl_printf(fd, "titles %zu:", cache_count);
+    for (int k = 0; k <= CAND_DONE; k++) if (stages[k]) ctl_printf(fd, " %s %u", CAND_NAMES[k], stages[k]);
+    ctl_printf(fd, "\ninstalls %d in flight (copy queue %d, register queue %d)\n", in_flight, copy_len, reg_len);
+    if (due >= 0) ctl_printf(fd, "next timer in %.0f ms (%zu scheduled)\n", due, wheel_count);
+    else ctl_printf(fd, "no timers scheduled\n");
+}
+
+// Forgets that the titles under root `i` (or just `path`) were handled and relists the root
+static int ctl_rescan_root(int i, const char* path) {
+    int n = 0;
+    for (size_t k = 0; k < cache_cap; k++) {
+        struct GameCache* e = cache[k];
+        if (!CACHE_LIVE(e) || e->root != i || !e->seen || e->stage == CAND_INSTALLING) continue;
+        if (path && strcmp(e->path, path) != 0) continue;
+        e->seen = false; n++;
+    }
+    memset(&roots[i].listed, 0, sizeof(roots[i].listed));
+    root_mark_dirty(i);
+    return n;
+}
+
+static void ctl_rescan(int fd, char* path) {
+    if (!*path) {
+        int n = 0, r = 0;
+        for (int i = 0; i < MAX_ROOTS; i++) if (roots[i].active) { n += ctl_rescan_root(i, NULL); r++; }
+        ctl_printf(fd, "ok: rescanning %d root(s), %d title(s) rechecked\n", r, n);
+        return;
+    }
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/') path[--len] = '\0';
+    for (int i = 0; i < MAX_ROOTS; i++) {
+        if (!roots[i].active) continue;
+        size_t rlen = strlen(roots[i].path);
+        if (!strcmp(roots[i].path, path)) { ctl_printf(fd, "ok: rescanning %s, %d title(s) rechecked\n", path, ctl_rescan_root(i, NULL)); return; }
+        if (!strncmp(roots[i].path, path, rlen) && path[rlen] == '/' && !strchr(path + rlen + 1, '/')) {
+            ctl_rescan_root(i, path);
+            ctl_printf(fd, "ok: rescanning %s\n", path);
+            return;
+        }
+    }
+    ctl_printf(fd, "error: %s is not a scan root or a folder directly under one\n", path);
+}
+
+static void ctl_dump_cache(int fd) {
+    ctl_printf(fd, "# path\ttitle_id\ttitle_name\tstage\tinstall\tdrm\troot\tseen\tretries\n");
+    for (size_t k = 0; k < cache_cap; k++) {
+        const struct GameCache* e = cache[k];
+        if (!CACHE_LIVE(e)) continue;
+        ctl_printf(fd, "%s\t%s\t%s\t%s\t%s\t%s\t%d\t%d\t%u\n", e->path, e->title_id, e->title_name,
+                   e->stage <= CAND_DONE ? CAND_NAMES[e->stage] : "?", e->install_state <= INST_FAILED ? INST_NAMES[e->install_state] : "?",
+                   e->drm_state <= DRM_FAILED ? DRM_NAMES[e->drm_state] : "?", e->root, e->seen, e->retries);
+    }
+}
+
+static void ctl_command(int fd, char* line) {
+    char* arg = line;
+    while (*arg && *arg != ' ') arg++;
+    if (*arg) *arg++ = '\0';
+    while (*arg == ' ') arg++;
+    log_debug("[CTL] %s%s%s", line, *arg ? " " : "", arg);
+    metric_inc(C_CTL_COMMANDS);
+    if (!strcmp(line, "status")) ctl_status(fd);
+    else if (!strcmp(line, "rescan")) ctl_rescan(fd, arg);
+    else if (!strcmp(line, "stop")) { ctl_stop = true; ctl_printf(fd, "ok: stopping\n"); }
+    else if (!strcmp(line, "dump-cache")) ctl_dump_cache(fd);
+    else if (!strcmp(line, "metrics")) metrics_write(fd);
+    else ctl_printf(fd, "error: unknown command '%s' (status | rescan [path] | stop | dump-cache | metrics)\n", line);
+}
+
+// Serves every pending connection. Main loop only.
+void ctl_serve(void) {
+    ctl_ready = false;
+    for (;;) {
+        int fd = accept(ctl_fd, NULL, NULL);
+        if (fd < 0) return;
+        fcntl(fd, F_SETFL, 0); // Accepted sockets may inherit O_NONBLOCK
+        struct timeval tv = { 0, 500000 }; // A stalled client must not hold up the loop
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        char line[MAX_PATH + 32]; size_t len = 0; ssize_t n;
+        while (len < sizeof(line) - 1 && (n = read(fd, line + len, sizeof(line) - 1 - len)) > 0) {
+            len += (size_t)n;
+            if (memchr(line, '\n', len)) break;
+        }
+        line[len] = '\0';
+        char* end = line + strcspn(line, "\r\n"); *end = '\0';
+        if (len) ctl_command(fd, line);
+        close(fd);
     }
 }
 
 int main() {
     // Initialize services
-    sceUserServiceInitialize(0);
-    sceAppInstUtilInitialize();
-    kernel_set_ucred_authid(-1, 0x4801000000000013L);
+    const char* platform = plat_init();
 
     remove(LOCK_FILE); 
     remove(LOG_FILE); 
     mkdir(LOG_DIR, 0777);
+    log_start();
+    log_debug("[PLAT] %s", platform);
     
     log_debug("SHADOWMOUNT v1.3 START");
     
     // --- STARTUP LOGIC ---
+    double t0 = now_ms(); started_at = t0;
+    watcher_init();
+    install_start();
+    index_load();
     int new_games = count_new_candidates();
+    index_save();
+    log_debug("[INDEX] Startup check: %d new, %zu known, %.1f ms", new_games, cache_count, now_ms() - t0);
     
     if (new_games == 0) {
         // SCENARIO A: Nothing to do.
@@ -386,6 +2873,7 @@ int main() {
         
         // Run the scan immediately to process them
         scan_all_paths();
+        install_drain();
         
         // Completion Message
         notify_system("Library Synchronized. - VoidWhisper");
@@ -393,18 +2881,27 @@ int main() {
 
     // --- DAEMON LOOP ---
     int lock = open(LOCK_FILE, O_CREAT | O_EXCL | O_RDWR, 0666);
-    if (lock < 0 && errno == EEXIST) { return 0; }
+    if (lock < 0 && errno == EEXIST) { log_flush(); return 0; }
+    ctl_start();
 
     while (true) {
-        if (access(KILL_FILE, F_OK) == 0) { remove(KILL_FILE); remove(LOCK_FILE); return 0; }
+        if (ctl_stop || access(KILL_FILE, F_OK) == 0) {
+            install_drain(); index_save(); metrics_save(); trace_export();
+            if (ctl_fd >= 0) { close(ctl_fd); unlink(CONTROL_SOCK); }
+            log_flush(); remove(KILL_FILE); remove(LOCK_FILE); return 0;
+        }
         
         // Sleep FIRST since we either just finished scan above, or library was ready.
-        sceKernelUsleep(SCAN_INTERVAL_US);
+        // Watched roots, the mount table, LOG_DIR, install workers and control clients
+        // wake us; the timeout only polls what cannot be watched and fires timers.
+        watcher_wait(watcher_idle_timeout(wheel_next_due_ms()));
+        if (ctl_ready) ctl_serve();
+        if (ctl_stop) continue;
         
         scan_all_paths();
     }
     
-    sceUserServiceTerminate();
+    plat_term();
     return 0;
 
 }
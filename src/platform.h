@@ -0,0 +1,51 @@
+#ifndef SHADOWMOUNT_PLATFORM_H
+#define SHADOWMOUNT_PLATFORM_H
+
+// Platform layer: everything main.c needs from the console that a dev box can stand in for.
+//   platform_ps5.c    the payload: nmount/nullfs, getfsstat, AppInstUtil, notifications
+//   platform_linux.c  `make host`: bind mounts or a recorded fake, /proc/self/mountinfo and a
+//                     fake AppInstUtil with configurable latency and error codes (see that file)
+// Calls that mirror a syscall return -1 and set errno on failure.
+#include <stdbool.h>
+#include <stdint.h>
+#ifndef __linux__
+#include <sys/param.h>
+#include <sys/mount.h>
+#endif
+
+// Longest mount source plat_mount_table() reports, plus the terminator. The console's
+// getfsstat() cuts f_mntfromname there; the recorded host mounts do the same.
+#ifdef MNAMELEN
+#define PLAT_MNAMELEN MNAMELEN
+#else
+#define PLAT_MNAMELEN 88
+#endif
+
+// Starts system services and raises credentials. Returns a one-line description for the log.
+const char* plat_init(void);
+void plat_term(void);
+
+void plat_sleep_us(unsigned us);
+void plat_notify(const char* msg);
+
+int plat_mount_nullfs(const char* src, const char* dst);    // Read-only
+int plat_remount_system_ex(void);                           // Makes /system_ex writable
+int plat_unmount(const char* path, bool force);
+
+// Registers /user/app/<title_id> with the system. Returns the AppInstUtil result code.
+int plat_install_title(const char* title_id, const char* install_dir);
+
+// One row of the mount table
+struct PlatMount {
+    uint64_t fsid;          // Identity of the mounted filesystem
+    const char* mnt;        // Mount point
+    const char* fstype;
+    const char* src;        // Source directory for nullfs/bind mounts, device otherwise; may be
+                            // cut at PLAT_MNAMELEN - 1 bytes
+    uint64_t src_fsid;      // Filesystem serving src, 0 if unknown (nullfs reports its own)
+};
+
+// Calls fn once per mounted filesystem. Returns -1 if the table could not be read.
+int plat_mount_table(void (*fn)(void* ctx, const struct PlatMount* m), void* ctx);
+
+#endif
@@ -0,0 +1,222 @@
+// Platform layer, Linux host backend for `make host` (see platform.h). Runs the real scan,
+// mount and install code on a dev box, as root in a container or VM: the console paths
+// (/data, /system_ex/app, /user/app, /user/appmeta) are used as they are.
+//
+// Mounts are recorded in memory and reported through plat_mount_table() like real ones,
+// so nothing is left mounted on the dev box. SM_HOST_MOUNT=bind uses read-only bind
+// mounts instead. AppInstUtil is faked: a successful call creates /user/appmeta/<id>.
+//
+// Environment (numbers accept 0x... hex):
+//   SM_HOST_MOUNT=record|bind      Mount backend (default record)
+//   SM_FAKE_MOUNT_US=n             Latency of each mount call
+//   SM_FAKE_MOUNT_ERR=errno        Fail mounts with this errno (e.g. 16 = EBUSY) ...
+//   SM_FAKE_MOUNT_ERR_EVERY=n      ... every nth call only (default every call)
+//   SM_FAKE_INSTALL_US=n           Latency of each AppInstUtil call
+//   SM_FAKE_INSTALL_ERR=code       Fail registrations with this result (e.g. 0x80990015) ...
+//   SM_FAKE_INSTALL_ERR_EVERY=n    ... every nth call only (default every call)
+//   SM_FAKE_APPMETA_US=n           Delay between a successful call and its appmeta folder
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/mount.h>
+#include <sys/sysmacros.h>
+
+#include "platform.h"
+
+#define MAX_PATH 1024
+
+struct FakeErr { int code; unsigned every; atomic_uint calls; };
+static struct {
+    bool bind;
+    unsigned mount_us, install_us, appmeta_us;
+    struct FakeErr mount_err, install_err;
+} cfg;
+
+static unsigned env_num(const char* name, unsigned def) {
+    const char* v = getenv(name);
+    return v && *v ? (unsigned)strtoul(v, NULL, 0) : def;
+}
+
+static void env_err(struct FakeErr* e, const char* name, const char* every) {
+    e->code = (int)env_num(name, 0); e->every = env_num(every, 1);
+    if (!e->every) e->every = 1;
+}
+
+// True if this call should fail with e->code
+static bool fake_fails(struct FakeErr* e) {
+    return e->code && (atomic_fetch_add(&e->calls, 1) + 1) % e->every == 0;
+}
+
+static void mkdirs(const char* path) {
+    char p[MAX_PATH]; snprintf(p, sizeof(p), "%s", path);
+    for (char* s = p + 1; *s; s++) if (*s == '/') { *s = '\0'; mkdir(p, 0777); *s = '/'; }
+    mkdir(p, 0777);
+}
+
+const char* plat_init(void) {
+    const char* mode = getenv("SM_HOST_MOUNT");
+    cfg.bind = mode && !strcmp(mode, "bind");
+    cfg.mount_us = env_num("SM_FAKE_MOUNT_US", 0);
+    cfg.install_us = env_num("SM_FAKE_INSTALL_US", 0);
+    cfg.appmeta_us = env_num("SM_FAKE_APPMETA_US", 0);
+    env_err(&cfg.mount_err, "SM_FAKE_MOUNT_ERR", "SM_FAKE_MOUNT_ERR_EVERY");
+    env_err(&cfg.install_err, "SM_FAKE_INSTALL_ERR", "SM_FAKE_INSTALL_ERR_EVERY");
+    mkdirs("/system_ex/app"); mkdirs("/user/app"); mkdirs("/user/appmeta");
+
+    static char desc[256];
+    snprintf(desc, sizeof(desc), "linux host: %s mounts (%u us, error %d every %u), fake AppInstUtil (%u us, error 0x%x every %u, appmeta after %u us)",
+             cfg.bind ? "bind" : "recorded", cfg.mount_us, cfg.mount_err.code, cfg.mount_err.every,
+             cfg.install_us, (unsigned)cfg.install_err.code, cfg.install_err.every, cfg.appmeta_us);
+    return desc;
+}
+
+void plat_term(void) {}
+
+void plat_sleep_us(unsigned us) { usleep(us); }
+
+void plat_notify(const char* msg) { (void)msg; } // Logged by the caller
+
+// --- Recorded mounts ---
+struct FakeMount { char mnt[MAX_PATH]; char src[PLAT_MNAMELEN]; uint64_t src_fsid; };
+static struct FakeMount* fake_mounts;
+static size_t fake_count, fake_cap;
+static pthread_mutex_t fake_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Recorded mounts get their own fsid space, like nullfs
+#define FAKE_FSID(k) (0xFA4E000000000000ull | (uint64_t)(k))
+
+static int fake_mount(const char* src, const char* dst) {
+    struct stat st, dst_st;
+    if (stat(src, &st) != 0 || stat(dst, &dst_st) != 0) return -1;
+    if (!S_ISDIR(st.st_mode) || !S_ISDIR(dst_st.st_mode)) { errno = ENOTDIR; return -1; }
+    pthread_mutex_lock(&fake_lock);
+    if (fake_count == fake_cap) {
+        size_t cap = fake_cap ? fake_cap * 2 : 64;
+        struct FakeMount* nf = (struct FakeMount*)realloc(fake_mounts, cap * sizeof(*nf));
+        if (!nf) { pthread_mutex_unlock(&fake_lock); errno = ENOMEM; return -1; }
+        fake_mounts = nf; fake_cap = cap;
+    }
+    struct FakeMount* m = &fake_mounts[fake_count++];
+    snprintf(m->mnt, sizeof(m->mnt), "%s", dst);
+    snprintf(m->src, sizeof(m->src), "%.*s", (int)sizeof(m->src) - 1, src); // Cut like f_mntfromname
+    m->src_fsid = ((uint64_t)major(st.st_dev) << 32) | minor(st.st_dev);
+    pthread_mutex_unlock(&fake_lock);
+    return 0;
+}
+
+// Removes the topmost recorded mount on `path`
+static int fake_unmount(const char* path) {
+    pthread_mutex_lock(&fake_lock);
+    for (size_t k = fake_count; k-- > 0; ) {
+        if (strcmp(fake_mounts[k].mnt, path) != 0) continue;
+        memmove(&fake_mounts[k], &fake_mounts[k + 1], (fake_count - k - 1) * sizeof(*fake_mounts));
+        fake_count--;
+        pthread_mutex_unlock(&fake_lock);
+        return 0;
+    }
+    pthread_mutex_unlock(&fake_lock);
+    errno = EINVAL; return -1;
+}
+
+int plat_mount_nullfs(const char* src, const char* dst) {
+    if (cfg.mount_us) usleep(cfg.mount_us);
+    if (fake_fails(&cfg.mount_err)) { errno = cfg.mount_err.code; return -1; }
+    if (!cfg.bind) return fake_mount(src, dst);
+    if (mount(src, dst, NULL, MS_BIND, NULL) != 0) return -1;
+    if (mount(NULL, dst, NULL, MS_BIND | MS_REMOUNT | MS_RDONLY, NULL) != 0) {
+        int err = errno; umount2(dst, MNT_DETACH); errno = err; return -1;
+    }
+    return 0;
+}
+
+int plat_remount_system_ex(void) { return 0; }
+
+int plat_unmount(const char* path, bool force) {
+    if (!cfg.bind) return fake_unmount(path);
+    return umount2(path, force ? MNT_DETACH : 0); // MNT_FORCE only affects network filesystems here
+}
+
+// --- Fake AppInstUtil ---
+static void* appmeta_later(void* arg) {
+    char* path = (char*)arg;
+    usleep(cfg.appmeta_us); mkdir(path, 0777); free(path);
+    return NULL;
+}
+
+int plat_install_title(const char* title_id, const char* install_dir) {
+    (void)install_dir;
+    if (cfg.install_us) usleep(cfg.install_us);
+    if (fake_fails(&cfg.install_err)) return cfg.install_err.code;
+    char path[MAX_PATH]; snprintf(path, sizeof(path), "/user/appmeta/%s", title_id);
+    char* later = cfg.appmeta_us ? strdup(path) : NULL;
+    pthread_t t;
+    if (later && pthread_create(&t, NULL, appmeta_later, later) == 0) pthread_detach(t);
+    else { free(later); mkdir(path, 0777); }
+    return 0;
+}
+
+// --- Mount table ---
+// Undoes the octal escapes (\040 etc.) used in /proc/self/mountinfo
+static void unescape_mount_field(char* s) {
+    char* o = s;
+    for (; *s; s++) {
+        if (s[0] == '\\' && s[1] >= '0' && s[1] <= '7' && s[2] >= '0' && s[2] <= '7' && s[3] >= '0' && s[3] <= '7') {
+            *o++ = (char)(((s[1] - '0') << 6) | ((s[2] - '0') << 3) | (s[3] - '0')); s += 3;
+        } else *o++ = *s;
+    }
+    *o = '\0';
+}
+
+struct MountRow { uint64_t dev; char root[MAX_PATH]; char mnt[MAX_PATH]; char fstype[32]; char source[MAX_PATH]; };
+static struct MountRow* rows;
+static size_t rows_cap;
+
+int plat_mount_table(void (*fn)(void* ctx, const struct PlatMount* m), void* ctx) {
+    FILE* f = fopen("/proc/self/mountinfo", "r"); if (!f) return -1;
+    size_t n = 0;
+    char line[4 * MAX_PATH];
+    while (fgets(line, sizeof(line), f)) {
+        // id parent major:minor root mount_point options [optional...] - fstype source super_options
+        if (n == rows_cap) {
+            size_t cap = rows_cap ? rows_cap * 2 : 64;
+            struct MountRow* nr = (struct MountRow*)realloc(rows, cap * sizeof(*nr)); if (!nr) break;
+            rows = nr; rows_cap = cap;
+        }
+        struct MountRow* r = &rows[n];
+        unsigned maj, min;
+        if (sscanf(line, "%*d %*d %u:%u %1023s %1023s", &maj, &min, r->root, r->mnt) != 4) continue;
+        const char* sep = strstr(line, " - "); if (!sep || sscanf(sep + 3, "%31s %1023s", r->fstype, r->source) != 2) continue;
+        unescape_mount_field(r->root); unescape_mount_field(r->mnt); unescape_mount_field(r->source);
+        r->dev = ((uint64_t)maj << 32) | min;
+        n++;
+    }
+    fclose(f);
+
+    // Bind mounts only name the directory inside their filesystem; resolve it against the
+    // first mount of that filesystem's root. That first mount is the original, not a bind.
+    for (size_t k = 0; k < n; k++) {
+        bool whole = !strcmp(rows[k].root, "/");
+        size_t r = 0;
+        while (r < n && (rows[r].dev != rows[k].dev || strcmp(rows[r].root, "/") != 0)) r++;
+        char src[MAX_PATH];
+        if (r == k) snprintf(src, sizeof(src), "%s", rows[k].source);
+        else if (r == n) snprintf(src, sizeof(src), "%s", rows[k].root);
+        else if (snprintf(src, sizeof(src), "%s%s", strcmp(rows[r].mnt, "/") ? rows[r].mnt : "", whole ? "" : rows[k].root) >= (int)sizeof(src)) continue; // Not a path we could mount from
+        if (!src[0]) strcpy(src, "/");
+        struct PlatMount m = { rows[k].dev, rows[k].mnt, rows[k].fstype, src, r == k ? 0 : rows[k].dev };
+        fn(ctx, &m);
+    }
+
+    pthread_mutex_lock(&fake_lock);
+    for (size_t k = 0; k < fake_count; k++) {
+        struct PlatMount m = { FAKE_FSID(k), fake_mounts[k].mnt, "nullfs", fake_mounts[k].src, fake_mounts[k].src_fsid };
+        fn(ctx, &m);
+    }
+    pthread_mutex_unlock(&fake_lock);
+    return 0;
+}
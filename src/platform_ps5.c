@@ -0,0 +1,78 @@
+// Platform layer, console backend (see platform.h)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include <sys/mount.h>
+#include <sys/uio.h>
+
+#include <ps5/kernel.h>
+
+#include "platform.h"
+
+#define IOVEC_ENTRY(x) { (void*)(x), (x) ? strlen(x) + 1 : 0 }
+#define IOVEC_SIZE(x)  (sizeof(x) / sizeof(struct iovec))
+
+// --- SDK Imports ---
+int sceAppInstUtilInitialize(void);
+int sceAppInstUtilAppInstallTitleDir(const char* title_id, const char* install_path, void* reserved);
+int sceKernelUsleep(unsigned int microseconds);
+int sceUserServiceInitialize(void*);
+void sceUserServiceTerminate(void);
+
+// Standard Notification
+typedef struct notify_request { char unused[45]; char message[3075]; } notify_request_t;
+int sceKernelSendNotificationRequest(int, notify_request_t*, size_t, int);
+
+const char* plat_init(void) {
+    sceUserServiceInitialize(0);
+    sceAppInstUtilInitialize();
+    kernel_set_ucred_authid(-1, 0x4801000000000013L);
+    return "ps5";
+}
+
+void plat_term(void) { sceUserServiceTerminate(); }
+
+void plat_sleep_us(unsigned us) { sceKernelUsleep(us); }
+
+void plat_notify(const char* msg) {
+    notify_request_t req; memset(&req, 0, sizeof(req));
+    strncpy(req.message, msg, sizeof(req.message) - 1);
+    sceKernelSendNotificationRequest(0, &req, sizeof(req), 0);
+}
+
+int plat_mount_nullfs(const char* src, const char* dst) {
+    struct iovec iov[] = { IOVEC_ENTRY("fstype"), IOVEC_ENTRY("nullfs"), IOVEC_ENTRY("from"), IOVEC_ENTRY(src), IOVEC_ENTRY("fspath"), IOVEC_ENTRY(dst) };
+    return nmount(iov, IOVEC_SIZE(iov), MNT_RDONLY);
+}
+
+int plat_remount_system_ex(void) {
+    struct iovec iov[] = { IOVEC_ENTRY("from"), IOVEC_ENTRY("/dev/ssd0.system_ex"), IOVEC_ENTRY("fspath"), IOVEC_ENTRY("/system_ex"), IOVEC_ENTRY("fstype"), IOVEC_ENTRY("exfatfs"), IOVEC_ENTRY("large"), IOVEC_ENTRY("yes"), IOVEC_ENTRY("timezone"), IOVEC_ENTRY("static"), IOVEC_ENTRY("async"), IOVEC_ENTRY(NULL), IOVEC_ENTRY("ignoreacl"), IOVEC_ENTRY(NULL) };
+    return nmount(iov, IOVEC_SIZE(iov), MNT_UPDATE);
+}
+
+int plat_unmount(const char* path, bool force) { return unmount(path, force ? MNT_FORCE : 0); }
+
+int plat_install_title(const char* title_id, const char* install_dir) {
+    return sceAppInstUtilAppInstallTitleDir(title_id, install_dir, 0);
+}
+
+static struct statfs* mnt_buf;
+static int mnt_cap;
+
+int plat_mount_table(void (*fn)(void* ctx, const struct PlatMount* m), void* ctx) {
+    int n = getfsstat(NULL, 0, MNT_NOWAIT); if (n < 0) return -1;
+    if (n + 4 > mnt_cap) {
+        struct statfs* nb = (struct statfs*)realloc(mnt_buf, (size_t)(n + 4) * sizeof(*nb)); if (!nb) return -1;
+        mnt_buf = nb; mnt_cap = n + 4;
+    }
+    n = getfsstat(mnt_buf, (long)(mnt_cap * sizeof(*mnt_buf)), MNT_NOWAIT); if (n < 0) return -1;
+    for (int k = 0; k < n; k++) {
+        struct PlatMount m = {
+            ((uint64_t)(uint32_t)mnt_buf[k].f_fsid.val[0] << 32) | (uint32_t)mnt_buf[k].f_fsid.val[1],
+            mnt_buf[k].f_mntonname, mnt_buf[k].f_fstypename, mnt_buf[k].f_mntfromname, 0 // nullfs: from = source directory, own fsid
+        };
+        fn(ctx, &m);
+    }
+    return 0;
+}
@@ -0,0 +1,246 @@
+// Behaviour tests for the host build (make check). Each case runs the real daemon code in a
+// fresh process against fresh tmpfs mounts on every path the daemon touches (bench/fixture.h,
+// shared with the benchmarks), so it needs root in a container or VM and leaves nothing behind.
+// Prints one line per case and exits non-zero if any failed.
+//
+//   shadowmount-test [case...]
+#define main shadowmount_main
+#include "main.c"
+#undef main
+#include "../bench/fixture.h"
+
+#include <sys/wait.h>
+
+#define TEST_ROOT     "/data/homebrew"
+#define TEST_DEADLINE 30000.0   // ms a case may take to reach its expected state
+
+// --- FIXTURES ---
+// A dump at TEST_ROOT/<name>
+static bool test_dump_at(const char* name, const char* title_id, const char* drm_type) {
+    char dir[MAX_PATH]; snprintf(dir, sizeof(dir), TEST_ROOT "/%s", name);
+    return fixture_dump(dir, title_id, drm_type);
+}
+
+static bool test_dump(const char* title_id, const char* drm_type) {
+    return test_dump_at(title_id, title_id, drm_type);
+}
+
+static bool test_drm_is(const char* title_id, const char* drm_type) {
+    char path[MAX_PATH], buf[512], want[64];
+    snprintf(path, sizeof(path), TEST_ROOT "/%s/sce_sys/param.json", title_id);
+    int fd = open(path, O_RDONLY); if (fd < 0) return false;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1); close(fd);
+    if (n <= 0) return false;
+    buf[n] = '\0';
+    snprintf(want, sizeof(want), "\"applicationDrmType\": \"%s\"", drm_type);
+    return strstr(buf, want) != NULL;
+}
+
+// Runs the daemon loop until the dump at `path` reaches `stage`. NULL if TEST_DEADLINE passes first.
+static struct GameCache* test_run_until_at(const char* path, uint8_t stage) {
+    double deadline = now_ms() + TEST_DEADLINE;
+    for (;;) {
+        scan_all_paths(); install_drain(); install_reap();
+        struct GameCache* game = cache_find(path);
+        if (game && game->stage == stage) return game;
+        if (now_ms() >= deadline) return NULL;
+        watcher_wait(watcher_idle_timeout(wheel_next_due_ms()));
+    }
+}
+
+static struct GameCache* test_run_until(const char* title_id, uint8_t stage) {
+    char path[MAX_PATH]; snprintf(path, sizeof(path), TEST_ROOT "/%s", title_id);
+    return test_run_until_at(path, stage);
+}
+
+static bool test_run_until_done(const char* title_id) {
+    return test_run_until(title_id, CAND_DONE) != NULL;
+}
+
+// --- CASES ---
+#define TEST_CHECK(cond) do { if (!(cond)) { fprintf(stderr, "  %s:%d: %s\n", __FILE__, __LINE__, #cond); return false; } } while (0)
+
+static bool test_fresh_title_migrated(void) {
+    TEST_CHECK(test_dump("PPSA00001", "upgradable"));
+    fixture_daemon_init();
+    TEST_CHECK(test_run_until_done("PPSA00001"));
+    TEST_CHECK(test_drm_is("PPSA00001", "standard"));
+    return true;
+}
+
+// An updated dump copied over an installed title, or a replugged drive: remounted, not installed
+static bool test_installed_title_migrated(void) {
+    TEST_CHECK(test_dump("PPSA00002", "upgradable"));
+    TEST_CHECK(fixture_mkdirs("/user/app/PPSA00002"));
+    fixture_daemon_init();
+    TEST_CHECK(test_run_until_done("PPSA00002"));
+    TEST_CHECK(test_drm_is("PPSA00002", "standard"));
+    return true;
+}
+
+// A different dump swapped in under the ID of a title that is still mounted
+static bool test_mounted_title_migrated(void) {
+    TEST_CHECK(test_dump("PPSA00003", "upgradable"));
+    TEST_CHECK(fixture_mkdirs("/user/app/PPSA00003"));
+    fixture_daemon_init();
+    TEST_CHECK(mount_title(TEST_ROOT "/PPSA00003", "PPSA00003"));
+    TEST_CHECK(test_run_until_done("PPSA00003"));
+    TEST_CHECK(test_drm_is("PPSA00003", "standard"));
+    return true;
+}
+
+// The dump replaced by a new directory at the same path: the mount still serves the old one
+static bool test_stale_mount_remounted(void) {
+    TEST_CHECK(test_dump("PPSA00005", "standard"));
+    fixture_daemon_init();
+    struct GameCache* game = test_run_until("PPSA00005", CAND_DONE);
+    TEST_CHECK(game && game->install_state == INST_MOUNTED);
+    TEST_CHECK(rename(TEST_ROOT "/PPSA00005", TEST_ROOT "/.PPSA00005.old") == 0);
+    TEST_CHECK(test_dump("PPSA00005", "standard"));
+    uint64_t mounts = metric_get(C_MOUNTS);
+    ctl_rescan_root(game->root, game->path);
+    TEST_CHECK(test_run_until_done("PPSA00005"));
+    TEST_CHECK(metric_get(C_MOUNTS) == mounts + 1);
+    struct stat st;
+    TEST_CHECK(stat(TEST_ROOT "/PPSA00005", &st) == 0 && game->mnt_ino == (uint64_t)st.st_ino);
+    return true;
+}
+
+// A dump path longer than the mount table keeps: its mount is still recognised on a recheck
+static bool test_long_path_kept(void) {
+    char name[PLAT_MNAMELEN + 32], path[MAX_PATH];
+    snprintf(name, sizeof(name), "PPSA00006-%0*d", PLAT_MNAMELEN, 0);
+    snprintf(path, sizeof(path), TEST_ROOT "/%s", name);
+    TEST_CHECK(test_dump_at(name, "PPSA00006", "standard"));
+    fixture_daemon_init();
+    struct GameCache* game = test_run_until_at(path, CAND_DONE);
+    TEST_CHECK(game);
+    scan_all_paths(); // Mount snapshot from the table, source cut short
+    const char* src = mount_source("PPSA00006");
+    TEST_CHECK(src && strlen(src) == PLAT_MNAMELEN - 1);
+    uint64_t mounts = metric_get(C_MOUNTS);
+    ctl_rescan_root(game->root, path);
+    scan_all_paths(); install_drain(); install_reap();
+    TEST_CHECK(game->stage == CAND_DONE && metric_get(C_MOUNTS) == mounts);
+    return true;
+}
+
+// An unplugged drive is reaped once it leaves the mount table: its titles are unmounted
+// and detached, its roots dropped
+static bool test_unplug_releases_drive(void) {
+    const char* drive = MOUNT_PREFIX "smtest0"; // Outside the sandbox: unmounted again before checking
+    bool mounted = fixture_tmpfs(drive);
+    bool ok = mounted && fixture_dump(MOUNT_PREFIX "smtest0/homebrew/PPSA00009", "PPSA00009", "standard");
+    fixture_daemon_init();
+    struct GameCache* game = ok ? test_run_until_at(MOUNT_PREFIX "smtest0/homebrew/PPSA00009", CAND_DONE) : NULL;
+    ok = game && game->install_state == INST_MOUNTED && game->root >= INTERNAL_ROOT_COUNT;
+    int root = ok ? game->root : 0;
+    uint64_t lost = metric_get(C_DEVICES_LOST);
+    if (mounted) umount2(drive, MNT_DETACH);
+    rmdir(drive);
+    TEST_CHECK(ok);
+    devices_refresh();
+    TEST_CHECK(metric_get(C_DEVICES_LOST) == lost + 1);
+    TEST_CHECK(game->root == -1 && game->install_state != INST_MOUNTED && !roots[root].active && roots[root].wd < 0);
+    scan_all_paths();
+    TEST_CHECK(!roots[root].active && !mount_source("PPSA00009"));
+    return true;
+}
+
+// A root relisted while a failed mount backs off leaves the retry to its timer
+static bool test_retry_keeps_backoff(void) {
+    setenv("SM_FAKE_MOUNT_ERR", "16", 1); // EBUSY: retried after 1 s, 2 s, ...
+    TEST_CHECK(test_dump("PPSA00004", "standard"));
+    fixture_daemon_init();
+    struct GameCache* game = test_run_until("PPSA00004", CAND_RETRY_WAIT);
+    TEST_CHECK(game && game->retries == 1 && game->scheduled);
+    uint64_t due = game->due_tick, listed = metric_get(C_ROOTS_LISTED);
+    root_mark_dirty(game->root);
+    scan_all_paths();
+    TEST_CHECK(metric_get(C_ROOTS_LISTED) > listed);
+    TEST_CHECK(game->stage == CAND_RETRY_WAIT && game->retries == 1 && game->scheduled && game->due_tick == due);
+    return true;
+}
+
+// A registration error of no known meaning is retried on the catch-all backoff, not given up
+static bool test_register_error_backs_off(void) {
+    setenv("SM_FAKE_INSTALL_ERR", "0x80990015", 1);
+    TEST_CHECK(test_dump("PPSA00007", "standard"));
+    fixture_daemon_init();
+    struct GameCache* game = test_run_until("PPSA00007", CAND_RETRY_WAIT);
+    TEST_CHECK(game && game->install_state == INST_FAILED && game->retries == 1 && game->scheduled);
+    TEST_CHECK(game->due_tick * (double)WHEEL_TICK_MS - game->stage_at >= 2000); // The catch-all's first delay
+    TEST_CHECK(metric_get(C_RETRIES) == 1);
+    return true;
+}
+
+// Lines of the metrics export that start with `prefix`; the last one goes to `last`
+static int test_metric_lines(const char* prefix, char* last, size_t last_size) {
+    char* text = NULL; size_t len = 0; int n = 0;
+    FILE* f = open_memstream(&text, &len); if (!f) return -1;
+    metrics_emit(f); fclose(f);
+    for (char* line = strtok(text, "\n"); line; line = strtok(NULL, "\n"))
+        if (!strncmp(line, prefix, strlen(prefix))) { n++; snprintf(last, last_size, "%s", line); }
+    free(text);
+    return n;
+}
+
+// Histograms export the same bucket boundaries whatever they hold, ending with +Inf. Bounds
+// are inclusive: a value of exactly 2^k us is not counted under le="(2^k - 1) us"
+static bool test_histogram_buckets_fixed(void) {
+    char last[256];
+    int empty = test_metric_lines("shadowmount_mount_seconds_bucket", last, sizeof(last));
+    TEST_CHECK(empty > 1 && !strcmp(last, "shadowmount_mount_seconds_bucket{le=\"+Inf\"} 0"));
+    hist_record(H_MOUNT, 1500);
+    TEST_CHECK(test_metric_lines("shadowmount_mount_seconds_bucket", last, sizeof(last)) == empty);
+    TEST_CHECK(!strcmp(last, "shadowmount_mount_seconds_bucket{le=\"+Inf\"} 1"));
+    TEST_CHECK(test_metric_lines("shadowmount_scan_cycle_seconds_bucket", last, sizeof(last)) == empty);
+    hist_record(H_MOUNT, 1023); hist_record(H_MOUNT, 1024);
+    TEST_CHECK(test_metric_lines("shadowmount_mount_seconds_bucket{le=\"0.001023\"}", last, sizeof(last)) == 1);
+    TEST_CHECK(!strcmp(last, "shadowmount_mount_seconds_bucket{le=\"0.001023\"} 1"));
+    TEST_CHECK(test_metric_lines("shadowmount_mount_seconds_bucket{le=\"0.002047\"}", last, sizeof(last)) == 1);
+    TEST_CHECK(!strcmp(last, "shadowmount_mount_seconds_bucket{le=\"0.002047\"} 3"));
+    return true;
+}
+
+struct TestCase { const char* name; bool (*fn)(void); };
+const struct TestCase TEST_CASES[] = {
+    { "fresh_title_migrated", test_fresh_title_migrated },
+    { "installed_title_migrated", test_installed_title_migrated },
+    { "mounted_title_migrated", test_mounted_title_migrated },
+    { "stale_mount_remounted", test_stale_mount_remounted },
+    { "long_path_kept", test_long_path_kept },
+    { "unplug_releases_drive", test_unplug_releases_drive },
+    { "retry_keeps_backoff", test_retry_keeps_backoff },
+    { "register_error_backs_off", test_register_error_backs_off },
+    { "histogram_buckets_fixed", test_histogram_buckets_fixed },
+    { NULL, NULL }
+};
+
+// --- RUNNER ---
+// Runs a case in a fresh process and sandbox so each one starts from the daemon's initial
+// state. Cases start the daemon with fixture_daemon_init(), which keeps its output off stdout.
+static bool test_fork(const struct TestCase* tc) {
+    if (!fixture_setup()) { fixture_teardown(); return false; }
+    pid_t pid = fork();
+    if (pid == 0) _exit(tc->fn() ? 0 : 1);
+    int status = 0;
+    while (pid > 0 && waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    fixture_teardown();
+    return pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char** argv) {
+    int failed = 0, run = 0;
+    for (int k = 0; TEST_CASES[k].name; k++) {
+        bool wanted = argc < 2;
+        for (int a = 1; a < argc; a++) if (!strcmp(argv[a], TEST_CASES[k].name)) wanted = true;
+        if (!wanted) continue;
+        bool ok = test_fork(&TEST_CASES[k]);
+        printf("%s %s\n", ok ? "ok  " : "FAIL", TEST_CASES[k].name);
+        fflush(stdout);
+        run++; if (!ok) failed++;
+    }
+    printf("%d/%d passed\n", run - failed, run);
+    return failed || !run ? 1 : 0;
+}